@@ -1,11 +1,12 @@
 #include "allnotesview.h"
 #include "database.h"
+#include "databaseworker.h"
 #include <QLabel>
 #include <QFrame>
 #include <QDateTime>
 
 AllNotesView::AllNotesView(QWidget *parent)
-    : QWidget(parent)
+    : QWidget(parent), loadGeneration(0)
 {
 
     QVBoxLayout *layout = new QVBoxLayout(this);
@@ -39,12 +40,8 @@ AllNotesView::AllNotesView(QWidget *parent)
 
 void AllNotesView::refreshNotes()
 {
-
-    QLayoutItem* item;
-    while ((item = contentLayout->takeAt(0)) != nullptr) {
-        delete item->widget();
-        delete item;
-    }
+    int generation = ++loadGeneration;
+    clearNotes();
     
     Database& db = Database::instance();
     if (!db.isLoggedIn()) {
@@ -55,9 +52,29 @@ void AllNotesView::refreshNotes()
     }
     
     int userId = db.getCurrentUserId();
-    auto notes = db.getNotes(userId);
-    
-    if (notes.isEmpty()) {
+    DatabaseWorker::instance().run([userId](Database& db) {
+        return db.getNotes(userId);
+    }).then(this, [this, generation](const std::vector<NoteRecord>& notes) {
+        if (generation != loadGeneration) {
+            return;
+        }
+        
+        showNotes(notes);
+    });
+}
+
+void AllNotesView::clearNotes()
+{
+    QLayoutItem* item;
+    while ((item = contentLayout->takeAt(0)) != nullptr) {
+        delete item->widget();
+        delete item;
+    }
+}
+
+void AllNotesView::showNotes(const std::vector<NoteRecord>& notes)
+{
+    if (notes.empty()) {
         QLabel *noNotesLabel = new QLabel("Заметок пока нет");
         noNotesLabel->setAlignment(Qt::AlignCenter);
         noNotesLabel->setStyleSheet("font-size: 14px; color: #666;");
@@ -65,7 +82,7 @@ void AllNotesView::refreshNotes()
         return;
     }
     
-    for (const auto& note : notes) {
+    for (const NoteRecord& note : notes) {
 
         QFrame *noteFrame = new QFrame;
         noteFrame->setFrameStyle(QFrame::Box);
@@ -74,12 +91,11 @@ void AllNotesView::refreshNotes()
         QVBoxLayout *noteLayout = new QVBoxLayout(noteFrame);
         noteLayout->setSpacing(5);
         
-        QString name = note["name"].toString();
-        QLabel *nameLabel = new QLabel(name);
+        QLabel *nameLabel = new QLabel(note.name);
         nameLabel->setStyleSheet("font-size: 16px; font-weight: bold; color: #333;");
         noteLayout->addWidget(nameLabel);
         
-        QString content = note["content"].toString();
+        QString content = note.content;
         if (content.isEmpty()) {
             content = "(пусто)";
         }
@@ -90,8 +106,8 @@ void AllNotesView::refreshNotes()
         contentEdit->setStyleSheet("QTextEdit { background-color: white; border: 1px solid #ccc; }");
         noteLayout->addWidget(contentEdit);
         
-        QDateTime createdAt = note["created_at"].toDateTime();
-        QDateTime updatedAt = note["updated_at"].toDateTime();
+        const QDateTime& createdAt = note.createdAt;
+        const QDateTime& updatedAt = note.updatedAt;
         QString dateText = "Создано: " + createdAt.toString("dd.MM.yyyy HH:mm");
         if (updatedAt != createdAt) {
             dateText += " | Обновлено: " + updatedAt.toString("dd.MM.yyyy HH:mm");
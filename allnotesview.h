@@ -8,6 +8,8 @@
 #include <QTextEdit>
 #include <QPushButton>
 #include <QLabel>
+#include <vector>
+#include "records.h"
 
 class AllNotesView : public QWidget
 {
@@ -28,6 +30,12 @@ private slots:
     void onBackClicked();
 
 private:
+    
+    void clearNotes();
+    
+    void showNotes(const std::vector<NoteRecord>& notes);
+    
+    int loadGeneration;
     QScrollArea *scrollArea;
     QWidget *contentWidget;
     QVBoxLayout *contentLayout;
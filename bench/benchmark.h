@@ -0,0 +1,77 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <algorithm>
+#include <vector>
+
+// Замеры для bench/: функция выполняется runs раз, и время каждого прогона сохраняется отдельно,
+// чтобы кроме среднего были видны и хвосты распределения.
+struct BenchStats
+{
+    int runs = 0;
+    double meanMs = 0;
+    double p50Ms = 0;
+    double p99Ms = 0;
+};
+
+template <typename Function>
+BenchStats measure(int runs, Function function)
+{
+    std::vector<double> samples;
+    samples.reserve(size_t(runs));
+    
+    QElapsedTimer timer;
+    for (int i = 0; i < runs; ++i) {
+        timer.start();
+        function();
+        samples.push_back(double(timer.nsecsElapsed()) / 1e6);
+    }
+    
+    BenchStats stats;
+    if (samples.empty()) {
+        return stats;
+    }
+    
+    std::sort(samples.begin(), samples.end());
+    stats.runs = runs;
+    for (double sample : samples) {
+        stats.meanMs += sample;
+    }
+    stats.meanMs /= runs;
+    stats.p50Ms = samples[size_t((runs - 1) * 50 / 100)];
+    stats.p99Ms = samples[size_t((runs - 1) * 99 / 100)];
+    return stats;
+}
+
+// Число операций в секунду при среднем времени прогона meanMs на count операций.
+inline double perSecond(int count, double meanMs)
+{
+    return meanMs > 0 ? count * 1000.0 / meanMs : 0;
+}
+
+inline void report(const QString& name, const BenchStats& stats, const QString& extra = QString())
+{
+    QTextStream out(stdout);
+    out << name.leftJustified(40)
+        << QString("runs=%1 mean=%2 ms p50=%3 ms p99=%4 ms")
+               .arg(stats.runs)
+               .arg(stats.meanMs, 0, 'f', 3)
+               .arg(stats.p50Ms, 0, 'f', 3)
+               .arg(stats.p99Ms, 0, 'f', 3);
+    if (!extra.isEmpty()) {
+        out << "  " << extra;
+    }
+    out << Qt::endl;
+}
+
+// Без аргументов выполняются все разделы, иначе только названные.
+inline bool wanted(const QStringList& sections, const QString& name)
+{
+    return sections.isEmpty() || sections.contains(name);
+}
+
+#endif
@@ -0,0 +1,266 @@
+#include <QCoreApplication>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QSqlQuery>
+#include <QHash>
+#include <QVariant>
+#include <QSettings>
+#include "benchmark.h"
+#include "database.h"
+
+// Замеры слоя базы данных на временных файлах. Запуск: databasebench [раздел ...];
+// без аргументов выполняются все разделы.
+
+static int openDatabase(const QTemporaryDir& dir, const QString& name)
+{
+    Database& db = Database::instance();
+    if (!db.initialize(dir.filePath(name + ".db"))) {
+        qFatal("Не удалось открыть базу %s", qPrintable(name));
+    }
+    
+    db.createUser("bench", "bench");
+    db.authenticateUser("bench", "bench");
+    return db.getCurrentUserId();
+}
+
+static std::vector<TaskRecord> makeTasks(const QDate& first, int days, int perDay)
+{
+    std::vector<TaskRecord> tasks;
+    tasks.reserve(size_t(days) * size_t(perDay));
+    for (int day = 0; day < days; ++day) {
+        for (int i = 0; i < perDay; ++i) {
+            TaskRecord task;
+            task.title = QString("Задача %1").arg(i);
+            task.date = first.addDays(day);
+            task.time = QTime(8, 0).addSecs((i % 90) * 600);
+            task.isTimeBound = i % 4 != 0;
+            tasks.push_back(task);
+        }
+    }
+    return tasks;
+}
+
+// Каждый выполненный запрос проходит через кэш подготовленных запросов.
+static quint64 statementCount()
+{
+    Database& db = Database::instance();
+    return db.statementCacheHits() + db.statementCacheMisses();
+}
+
+// Сетка месяца — 42 дня: по запросу на каждый день против одного запроса за период.
+static void benchMonthQuery(const QTemporaryDir& dir)
+{
+    int userId = openDatabase(dir, "range");
+    Database& db = Database::instance();
+    db.createTasks(userId, makeTasks(QDate(2026, 1, 1), 365, 20));
+    
+    QDate gridStart(2026, 5, 25);
+    QDate gridEnd = gridStart.addDays(41);
+    const int runs = 200;
+    
+    quint64 before = statementCount();
+    BenchStats perDay = measure(runs, [&]() {
+        for (QDate date = gridStart; date <= gridEnd; date = date.addDays(1)) {
+            db.getTasksForDay(userId, date);
+        }
+    });
+    quint64 queries = (statementCount() - before) / runs;
+    report("month: getTasksForDay x42", perDay,
+           QString("queries=%1 ms/query=%2").arg(queries).arg(perDay.meanMs / queries, 0, 'f', 4));
+    
+    before = statementCount();
+    BenchStats range = measure(runs, [&]() {
+        db.getTasksForRange(userId, gridStart, gridEnd);
+    });
+    queries = (statementCount() - before) / runs;
+    report("month: getTasksForRange", range,
+           QString("queries=%1 ms/query=%2").arg(queries).arg(range.meanMs / queries, 0, 'f', 4));
+}
+
+// Выборка периода без повторяющихся задач; обе стороны замера читают её одним и тем же
+// подготовленным запросом, так что разница — только в построении записей.
+static void prepareRangeQuery(QSqlQuery& query, int userId, const QDate& from, const QDate& to)
+{
+    query.prepare("SELECT id, title, task_day, task_minute, is_time_bound, recurrence_rule "
+                  "FROM tasks WHERE user_id = ? AND task_day >= ? AND task_day <= ? AND recurrence_rule IS NULL "
+                  "ORDER BY task_day ASC, is_time_bound DESC, task_minute ASC");
+    query.addBindValue(userId);
+    query.addBindValue(from.toJulianDay());
+    query.addBindValue(to.toJulianDay());
+}
+
+static std::vector<TaskRecord> readRowsAsRecords(QSqlQuery& query)
+{
+    std::vector<TaskRecord> records;
+    query.exec();
+    while (query.next()) {
+        records.push_back(readRecord<TaskRecord>(query));
+    }
+    return records;
+}
+
+// Прежнее представление строки: QHash<QString, QVariant> на каждую запись, столбцы по номеру.
+static QList<QHash<QString, QVariant>> readRowsAsHashes(QSqlQuery& query)
+{
+    QList<QHash<QString, QVariant>> rows;
+    query.exec();
+    while (query.next()) {
+        QHash<QString, QVariant> row;
+        row["id"] = query.value(0);
+        row["title"] = query.value(1);
+        row["task_date"] = QDate::fromJulianDay(query.value(2).toLongLong());
+        row["task_time"] = QTime(0, 0).addSecs(query.value(3).toInt() * 60);
+        row["is_time_bound"] = query.value(4);
+        row["recurrence"] = query.value(5);
+        rows.append(row);
+    }
+    return rows;
+}
+
+// Стоимость превращения строк выборки в записи: типизированные TaskRecord против строк-хэшей.
+static void benchRecords(const QTemporaryDir& dir)
+{
+    int userId = openDatabase(dir, "records");
+    QDate first(2026, 1, 1);
+    Database::instance().createTasks(userId, makeTasks(first, 1000, 100));
+    
+    for (int days : {100, 1000}) {
+        QDate last = first.addDays(days - 1);
+        int rows = days * 100;
+        const int runs = days == 100 ? 50 : 10;
+        
+        QSqlQuery query(Database::instance().connection());
+        prepareRangeQuery(query, userId, first, last);
+        
+        BenchStats typed = measure(runs, [&]() {
+            readRowsAsRecords(query);
+        });
+        report(QString("records: TaskRecord %1k").arg(rows / 1000), typed,
+               QString("records/s=%1").arg(perSecond(rows, typed.meanMs), 0, 'f', 0));
+        
+        BenchStats hashed = measure(runs, [&]() {
+            readRowsAsHashes(query);
+        });
+        report(QString("records: QHash rows %1k").arg(rows / 1000), hashed,
+               QString("records/s=%1").arg(perSecond(rows, hashed.meanMs), 0, 'f', 0));
+    }
+}
+
+// Скорость записи под каждым профилем хранилища; "sqliteDefaults" — SQLite без настройки,
+// как было до профилей. Профиль применяется при открытии, поэтому у каждого своя база.
+static void benchStorageProfiles(const QTemporaryDir& dir)
+{
+    const int inserts = 200;
+    const int batchSize = 10000;
+    const int toggles = 200;
+    
+    for (const QString& profile : {QString("sqliteDefaults"), QString("desktop"), QString("bulkImport")}) {
+        {
+            QSettings settings;
+            settings.remove("storage");
+            if (profile == "sqliteDefaults") {
+                settings.setValue("storage/journalMode", "DELETE");
+                settings.setValue("storage/synchronous", "FULL");
+                settings.setValue("storage/cacheSize", -2000);
+                settings.setValue("storage/mmapSize", 0);
+                settings.setValue("storage/tempStore", "DEFAULT");
+            } else {
+                settings.setValue("storage/profile", profile);
+            }
+        }
+        
+        int userId = openDatabase(dir, "profile-" + profile);
+        Database& db = Database::instance();
+        QDate date(2026, 3, 1);
+        
+        BenchStats single = measure(5, [&]() {
+            for (int i = 0; i < inserts; ++i) {
+                db.createTask(userId, "Задача", QDateTime(date, QTime(9, 0)), true);
+            }
+        });
+        report(QString("%1: createTask").arg(profile), single,
+               QString("inserts/s=%1").arg(perSecond(inserts, single.meanMs), 0, 'f', 0));
+        
+        std::vector<TaskRecord> tasks = makeTasks(date, batchSize / 50, 50);
+        BenchStats batch = measure(3, [&]() {
+            db.createTasks(userId, tasks);
+        });
+        report(QString("%1: createTasks batch").arg(profile), batch,
+               QString("inserts/s=%1").arg(perSecond(batchSize, batch.meanMs), 0, 'f', 0));
+        
+        int habitId = db.createHabit(userId, "Привычка");
+        std::vector<bool> marked(30, false);
+        BenchStats toggle = measure(5, [&]() {
+            for (int i = 0; i < toggles; ++i) {
+                int day = i % 30;
+                marked[day] = !marked[day];
+                if (marked[day]) {
+                    db.markHabitCompleted(habitId, date.addDays(day));
+                } else {
+                    db.unmarkHabitCompleted(habitId, date.addDays(day));
+                }
+            }
+        });
+        report(QString("%1: habit toggle").arg(profile), toggle,
+               QString("toggles/s=%1").arg(perSecond(toggles, toggle.meanMs), 0, 'f', 0));
+    }
+    
+    QSettings().remove("storage");
+}
+
+// Почасовое правило, развёрнутое на год: отдельно перебор повторений и выборка периода из базы.
+static void benchRecurrence(const QTemporaryDir& dir)
+{
+    RecurrenceRule hourly(RecurrenceRule::Frequency::Hourly, 1);
+    QDate start(2026, 1, 1);
+    QDate end = start.addYears(1);
+    
+    int occurrences = 0;
+    BenchStats expand = measure(50, [&]() {
+        occurrences = 0;
+        hourly.forEachOccurrence(start, QTime(0, 30), start, end, [&occurrences](const QDate&, const QTime&) {
+            ++occurrences;
+        });
+    });
+    report("recurrence: hourly x1 year", expand,
+           QString("occurrences=%1 ns/occurrence=%2").arg(occurrences)
+               .arg(expand.meanMs * 1e6 / qMax(occurrences, 1), 0, 'f', 1));
+    
+    int userId = openDatabase(dir, "recurrence");
+    Database& db = Database::instance();
+    db.createTask(userId, "Каждый час", QDateTime(start, QTime(0, 30)), true, hourly);
+    
+    BenchStats range = measure(10, [&]() {
+        db.getTasksForRange(userId, start, end.addDays(-1));
+    });
+    report("recurrence: getTasksForRange 1 year", range,
+           QString("occurrences/s=%1").arg(perSecond(occurrences, range.meanMs), 0, 'f', 0));
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("databasebench");
+    QStandardPaths::setTestModeEnabled(true);
+    
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        qFatal("Не удалось создать временный каталог");
+    }
+    
+    QStringList sections = app.arguments().mid(1);
+    if (wanted(sections, "range")) {
+        benchMonthQuery(dir);
+    }
+    if (wanted(sections, "records")) {
+        benchRecords(dir);
+    }
+    if (wanted(sections, "profiles")) {
+        benchStorageProfiles(dir);
+    }
+    if (wanted(sections, "recurrence")) {
+        benchRecurrence(dir);
+    }
+    
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <QApplication>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QPushButton>
+#include <QImage>
+#include "benchmark.h"
+#include "database.h"
+#include "databaseworker.h"
+#include "taskrepository.h"
+#include "taskmodel.h"
+#include "weekview.h"
+#include "monthview.h"
+#include "monthgrid.h"
+
+// Замеры представлений без экрана (платформа offscreen). Запуск: viewbench [раздел ...];
+// без аргументов выполняются все разделы.
+
+static QPushButton* findButton(QWidget *view, const QString& text)
+{
+    for (QPushButton *button : view->findChildren<QPushButton*>()) {
+        if (button->text() == text) {
+            return button;
+        }
+    }
+    qFatal("Кнопка %s не найдена", qPrintable(text));
+    return nullptr;
+}
+
+// Время от нажатия стрелки до сброса модели на новый период и перерисовки представления,
+// как при удержании стрелки: соседний период к этому моменту уже подгружен заранее.
+static void benchNavigation(const QString& name, QWidget *view, TaskModel *model, int steps)
+{
+    bool reset = false;
+    QMetaObject::Connection connection = QObject::connect(model, &QAbstractItemModel::modelReset, [&reset]() {
+        reset = true;
+    });
+    
+    QPushButton *next = findButton(view, "→");
+    auto navigate = [&]() {
+        reset = false;
+        next->click();
+        while (!reset) {
+            QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+        }
+        view->repaint();
+    };
+    
+    // Первый переход ждёт базу: в замер не входит.
+    navigate();
+    BenchStats stats = measure(steps, navigate);
+    report(name, stats, QString("cacheHits=%1 cacheMisses=%2")
+               .arg(TaskRepository::instance().cacheHits())
+               .arg(TaskRepository::instance().cacheMisses()));
+    
+    QObject::disconnect(connection);
+}
+
+// Отрисовка сетки месяца в QImage: отдельно кадр без изменений и смена месяца с заполнением
+// всех 42 ячеек и перерисовкой.
+static void benchMonthGrid()
+{
+    MonthGrid grid;
+    grid.resize(1100, 620);
+    grid.setDayNames({"Пн", "Вт", "Ср", "Чт", "Пт", "Сб", "Вс"});
+    QImage image(grid.size(), QImage::Format_ARGB32_Premultiplied);
+    
+    QStringList texts;
+    QStringList titles;
+    for (int i = 0; i < 5; ++i) {
+        titles << QString("Длинное название задачи номер %1").arg(i);
+        texts << QString("%1:00 ").arg(9 + i) + titles.last();
+    }
+    
+    QDate month(2026, 1, 1);
+    auto fill = [&]() {
+        QDate firstDate = month.addDays(1 - month.dayOfWeek());
+        grid.setMonth(firstDate, month);
+        for (int cell = 0; cell < MonthGrid::CellCount; ++cell) {
+            if (grid.isCurrentMonth(cell)) {
+                grid.setDayTasks(cell, texts, titles, true);
+            }
+        }
+    };
+    fill();
+    
+    BenchStats paint = measure(200, [&]() {
+        grid.render(&image);
+    });
+    report("monthgrid: paint", paint);
+    
+    BenchStats switchMonth = measure(200, [&]() {
+        month = month.addMonths(1);
+        fill();
+        grid.render(&image);
+    });
+    report("monthgrid: switch month + paint", switchMonth);
+}
+
+static void seedDatabase(const QTemporaryDir& dir)
+{
+    Database& db = Database::instance();
+    if (!dir.isValid() || !db.initialize(dir.filePath("views.db"))) {
+        qFatal("Не удалось открыть базу");
+    }
+    db.createUser("bench", "bench");
+    db.authenticateUser("bench", "bench");
+    
+    std::vector<TaskRecord> tasks;
+    QDate first = QDate::currentDate().addDays(-30);
+    for (int day = 0; day < 3 * 365; ++day) {
+        for (int i = 0; i < 20; ++i) {
+            TaskRecord task;
+            task.title = QString("Задача %1").arg(i);
+            task.date = first.addDays(day);
+            task.time = QTime(8, 0).addSecs(i * 1800);
+            tasks.push_back(task);
+        }
+    }
+    db.createTasks(db.getCurrentUserId(), tasks);
+}
+
+int main(int argc, char *argv[])
+{
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    QCoreApplication::setApplicationName("viewbench");
+    QStandardPaths::setTestModeEnabled(true);
+    
+    QStringList sections = app.arguments().mid(1);
+    if (wanted(sections, "monthgrid")) {
+        benchMonthGrid();
+    }
+    
+    if (wanted(sections, "navigation")) {
+        QTemporaryDir dir;
+        seedDatabase(dir);
+        DatabaseWorker::instance().start();
+        
+        TaskModel model;
+        
+        WeekView weekView(&model);
+        weekView.resize(1200, 700);
+        weekView.show();
+        benchNavigation("navigation: next week", &weekView, &model, 100);
+        weekView.hide();
+        
+        MonthView monthView(&model);
+        monthView.resize(1200, 700);
+        monthView.show();
+        benchNavigation("navigation: next month", &monthView, &model, 30);
+        
+        DatabaseWorker::instance().stop();
+    }
+    
+    return 0;
+}
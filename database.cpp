@@ -1,9 +1,15 @@
 #include "database.h"
+#include "databasenotifier.h"
 #include <QCryptographicHash>
 #include <QDebug>
 #include <QStandardPaths>
 #include <QDir>
 #include <QSqlError>
+#include <QSettings>
+#include <QPair>
+#include <QMutexLocker>
+#include <QSet>
+#include <algorithm>
 
 Database& Database::instance()
 {
@@ -11,38 +17,142 @@ Database& Database::instance()
     return instance;
 }
 
-Database::Database() : currentUserId(-1)
+Database::Database() : ownerThread(QThread::currentThread()), pooledConnections(0), nextConnectionId(0),
+                       connectionGeneration(0), currentUserId(-1), habitStorage(HabitStorage::Rows), cacheHits(0), cacheMisses(0)
 {
 }
 
 Database::~Database()
 {
-    if (db.isOpen()) {
-        db.close();
+    mainConnection.statements.clear();
+    if (mainConnection.db.isOpen()) {
+        mainConnection.db.close();
     }
 }
 
-bool Database::initialize()
+bool Database::initialize(const QString& path)
 {
-    db = QSqlDatabase::addDatabase("QSQLITE");
+    ownerThread = QThread::currentThread();
     
-    QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-    QDir().mkpath(dataPath);
-    QString dbPath = dataPath + "/tasks.db";
+    QSqlDatabase& db = mainConnection.db;
+    mainConnection.statements.clear();
+    // Соединения других потоков открыты на прежний файл: каждое переоткроется при следующем обращении.
+    ++connectionGeneration;
+    if (db.isOpen()) {
+        db.close();
+    }
     
-    db.setDatabaseName(dbPath);
+    if (!db.isValid()) {
+        db = QSqlDatabase::addDatabase("QSQLITE");
+    }
+    
+    if (path.isEmpty()) {
+        QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+        QDir().mkpath(dataPath);
+        databasePath = dataPath + "/tasks.db";
+    } else {
+        databasePath = path;
+    }
+    
+    db.setDatabaseName(databasePath);
     
     if (!db.open()) {
         qDebug() << "Ошибка открытия базы данных:" << db.lastError().text();
         return false;
     }
     
-    return createTables();
+    QSettings settings;
+    habitStorage = settings.value("habitStorage", "rows").toString() == "bitmap"
+                   ? HabitStorage::Bitmap : HabitStorage::Rows;
+    profile = StorageProfile::fromSettings(settings);
+    
+    if (!configureConnection(db)) {
+        return false;
+    }
+    
+    return createTables() && migrateTaskSchema() && migrateHabitStorage();
+}
+
+bool Database::configureConnection(QSqlDatabase& db)
+{
+    QSqlQuery query(db);
+    
+    for (const QString& pragma : profile.pragmas()) {
+        if (!query.exec(pragma)) {
+            qDebug() << "Ошибка настройки соединения:" << pragma << query.lastError().text();
+            return false;
+        }
+    }
+    
+    if (query.exec("PRAGMA journal_mode") && query.next()
+        && query.value(0).toString().toUpper() != profile.journalMode) {
+        qDebug() << "SQLite не переключился в режим журнала" << profile.journalMode
+                 << ", используется" << query.value(0).toString();
+    }
+    
+    return true;
+}
+
+Database::PooledConnection* Database::openPooledConnection()
+{
+    QString connectionName = QString("tasks_db_%1").arg(++nextConnectionId);
+    
+    PooledConnection *pooled = new PooledConnection;
+    pooled->db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    pooled->db.setDatabaseName(databasePath);
+    pooled->generation = connectionGeneration;
+    ++pooledConnections;
+    
+    if (!pooled->db.open()) {
+        qDebug() << "Ошибка открытия соединения" << connectionName << ":" << pooled->db.lastError().text();
+    } else {
+        configureConnection(pooled->db);
+    }
+    
+    return pooled;
+}
+
+Database::PooledConnection::~PooledConnection()
+{
+    QString connectionName = db.connectionName();
+    statements.clear();
+    db.close();
+    db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(connectionName);
+    --Database::instance().pooledConnections;
+}
+
+Database::Connection& Database::currentConnection()
+{
+    if (QThread::currentThread() == ownerThread) {
+        return mainConnection;
+    }
+    
+    // Устаревшее соединение удаляется вместе с кэшем запросов; открытый пакет доводится до конца.
+    PooledConnection *pooled = threadConnections.hasLocalData() ? threadConnections.localData() : nullptr;
+    if (!pooled || (pooled->generation != connectionGeneration && !pooled->inBatch)) {
+        pooled = openPooledConnection();
+        threadConnections.setLocalData(pooled);
+    }
+    
+    return *pooled;
+}
+
+void Database::releaseThreadConnection()
+{
+    if (QThread::currentThread() != ownerThread && threadConnections.hasLocalData()) {
+        threadConnections.setLocalData(nullptr);
+    }
+}
+
+QSqlDatabase& Database::connection()
+{
+    return currentConnection().db;
 }
 
 bool Database::createTables()
 {
-    QSqlQuery query;
+    QSqlQuery query(connection());
     
     query.exec("CREATE TABLE IF NOT EXISTS users ("
                "id INTEGER PRIMARY KEY AUTOINCREMENT,"
@@ -60,10 +170,10 @@ bool Database::createTables()
                "id INTEGER PRIMARY KEY AUTOINCREMENT,"
                "user_id INTEGER NOT NULL,"
                "title TEXT NOT NULL,"
-               "task_date DATE NOT NULL,"
-               "task_time TIME,"
+               "task_day INTEGER NOT NULL,"
+               "task_minute INTEGER,"
                "is_time_bound INTEGER NOT NULL DEFAULT 1,"
-               "recurrence TEXT,"
+               "recurrence_rule INTEGER,"
                "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,"
                "FOREIGN KEY(user_id) REFERENCES users(id) ON DELETE CASCADE"
                ")");
@@ -73,7 +183,18 @@ bool Database::createTables()
         return false;
     }
     
-    query.exec("CREATE INDEX IF NOT EXISTS idx_tasks_user_date ON tasks(user_id, task_date)");
+    query.exec("CREATE TABLE IF NOT EXISTS reminder_deliveries ("
+               "task_id INTEGER NOT NULL,"
+               "due_at INTEGER NOT NULL,"
+               "delivered_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,"
+               "PRIMARY KEY(task_id, due_at),"
+               "FOREIGN KEY(task_id) REFERENCES tasks(id) ON DELETE CASCADE"
+               ") WITHOUT ROWID");
+    
+    if (query.lastError().isValid()) {
+        qDebug() << "Ошибка создания таблицы reminder_deliveries:" << query.lastError().text();
+        return false;
+    }
     
     query.exec("CREATE TABLE IF NOT EXISTS habits ("
                "id INTEGER PRIMARY KEY AUTOINCREMENT,"
@@ -101,6 +222,31 @@ bool Database::createTables()
         return false;
     }
     
+    query.exec("CREATE TABLE IF NOT EXISTS habit_completion_years ("
+               "habit_id INTEGER NOT NULL,"
+               "year INTEGER NOT NULL,"
+               "days BLOB NOT NULL,"
+               "PRIMARY KEY(habit_id, year),"
+               "FOREIGN KEY(habit_id) REFERENCES habits(id) ON DELETE CASCADE"
+               ") WITHOUT ROWID");
+    
+    if (query.lastError().isValid()) {
+        qDebug() << "Ошибка создания таблицы habit_completion_years:" << query.lastError().text();
+        return false;
+    }
+    
+    query.exec("CREATE TABLE IF NOT EXISTS habit_streaks ("
+               "habit_id INTEGER PRIMARY KEY,"
+               "last_completion DATE,"
+               "streak_length INTEGER NOT NULL DEFAULT 0,"
+               "FOREIGN KEY(habit_id) REFERENCES habits(id) ON DELETE CASCADE"
+               ")");
+    
+    if (query.lastError().isValid()) {
+        qDebug() << "Ошибка создания таблицы habit_streaks:" << query.lastError().text();
+        return false;
+    }
+    
     query.exec("CREATE TABLE IF NOT EXISTS notes ("
                "id INTEGER PRIMARY KEY AUTOINCREMENT,"
                "user_id INTEGER NOT NULL,"
@@ -119,6 +265,224 @@ bool Database::createTables()
     return true;
 }
 
+QString Database::statementSql(StatementId id)
+{
+    switch (id) {
+    case StatementId::InsertUser:
+        return "INSERT INTO users (username, password_hash) VALUES (?, ?)";
+    case StatementId::SelectUserByName:
+        return "SELECT id, password_hash FROM users WHERE username = ?";
+    case StatementId::InsertTask:
+        return "INSERT INTO tasks (user_id, title, task_day, task_minute, is_time_bound, recurrence_rule) "
+               "VALUES (?, ?, ?, ?, ?, ?)";
+    case StatementId::UpdateTask:
+        return "UPDATE tasks SET title = ?, task_day = ?, task_minute = ?, "
+               "is_time_bound = ?, recurrence_rule = ? WHERE id = ?";
+    case StatementId::DeleteTask:
+        return "DELETE FROM tasks WHERE id = ?";
+    case StatementId::SelectTaskSchedule:
+        return "SELECT user_id, task_day, recurrence_rule IS NOT NULL FROM tasks WHERE id = ?";
+    case StatementId::TasksForDay:
+        return "SELECT id, title, task_day, task_minute, is_time_bound, recurrence_rule "
+               "FROM tasks WHERE user_id = ? AND task_day = ? AND recurrence_rule IS NULL "
+               "ORDER BY is_time_bound DESC, task_minute ASC";
+    case StatementId::TasksForWeek:
+        return "SELECT id, title, task_day, task_minute, is_time_bound, recurrence_rule "
+               "FROM tasks WHERE user_id = ? AND task_day >= ? AND task_day <= ? AND recurrence_rule IS NULL "
+               "ORDER BY task_day ASC, is_time_bound DESC, task_minute ASC";
+    case StatementId::TasksForRange:
+        return "SELECT id, title, task_day, task_minute, is_time_bound, recurrence_rule "
+               "FROM tasks WHERE user_id = ? AND task_day >= ? AND task_day <= ? AND recurrence_rule IS NULL "
+               "ORDER BY task_day ASC, is_time_bound DESC, task_minute ASC";
+    case StatementId::DeleteOldTasks:
+        return "DELETE FROM tasks WHERE user_id = ? AND task_day < ? AND recurrence_rule IS NULL";
+    case StatementId::RecurringTasks:
+        return "SELECT id, title, task_day, task_minute, is_time_bound, recurrence_rule "
+               "FROM tasks WHERE user_id = ? AND recurrence_rule IS NOT NULL AND task_day < ?";
+    case StatementId::PendingReminders:
+        return "SELECT id, title, task_day, task_minute, is_time_bound, recurrence_rule FROM tasks "
+               "WHERE user_id = ? AND task_day >= ? AND task_day <= ? AND is_time_bound = 1 "
+               "AND recurrence_rule IS NULL "
+               "AND task_day * 1440 + task_minute >= ? AND task_day * 1440 + task_minute < ? "
+               "AND NOT EXISTS (SELECT 1 FROM reminder_deliveries "
+               "WHERE task_id = tasks.id AND due_at = tasks.task_day * 1440 + tasks.task_minute) "
+               "ORDER BY task_day ASC, task_minute ASC";
+    case StatementId::DeliveredOccurrences:
+        return "SELECT d.task_id, d.due_at FROM reminder_deliveries d JOIN tasks t ON t.id = d.task_id "
+               "WHERE t.user_id = ? AND t.recurrence_rule IS NOT NULL AND d.due_at >= ? AND d.due_at < ?";
+    case StatementId::InsertReminderDelivery:
+        return "INSERT OR IGNORE INTO reminder_deliveries (task_id, due_at) VALUES (?, ?)";
+    case StatementId::DeleteTaskDeliveries:
+        return "DELETE FROM reminder_deliveries WHERE task_id = ?";
+    case StatementId::DeleteOldDeliveries:
+        return "DELETE FROM reminder_deliveries WHERE due_at < ?";
+    case StatementId::InsertNote:
+        return "INSERT INTO notes (user_id, name, content) VALUES (?, ?, ?)";
+    case StatementId::UpdateNote:
+        return "UPDATE notes SET name = ?, content = ?, updated_at = CURRENT_TIMESTAMP WHERE id = ?";
+    case StatementId::DeleteNote:
+        return "DELETE FROM notes WHERE id = ?";
+    case StatementId::SelectNotes:
+        return "SELECT id, user_id, name, content, created_at, updated_at FROM notes WHERE user_id = ? ORDER BY updated_at DESC";
+    case StatementId::SelectNote:
+        return "SELECT id, user_id, name, content, created_at, updated_at FROM notes WHERE id = ?";
+    case StatementId::InsertHabit:
+        return "INSERT INTO habits (user_id, name) VALUES (?, ?)";
+    case StatementId::DeleteHabit:
+        return "DELETE FROM habits WHERE id = ?";
+    case StatementId::SelectHabits:
+        return "SELECT id, name, created_at FROM habits WHERE user_id = ? ORDER BY created_at DESC";
+    case StatementId::MarkHabitCompleted:
+        return "INSERT OR IGNORE INTO habit_completions (habit_id, completion_date) VALUES (?, ?)";
+    case StatementId::UnmarkHabitCompleted:
+        return "DELETE FROM habit_completions WHERE habit_id = ? AND completion_date = ?";
+    case StatementId::IsHabitCompleted:
+        return "SELECT COUNT(*) FROM habit_completions WHERE habit_id = ? AND completion_date = ?";
+    case StatementId::HabitCompletionsInRange:
+        return "SELECT completion_date FROM habit_completions "
+               "WHERE habit_id = ? AND completion_date >= ? AND completion_date < ? "
+               "ORDER BY completion_date ASC";
+    case StatementId::HabitCompletionCount:
+        return "SELECT COUNT(*) FROM habit_completions "
+               "WHERE habit_id = ? AND completion_date >= ? AND completion_date < ?";
+    case StatementId::SelectHabitYear:
+        return "SELECT days FROM habit_completion_years WHERE habit_id = ? AND year = ?";
+    case StatementId::SelectHabitYearsInRange:
+        return "SELECT year, days FROM habit_completion_years "
+               "WHERE habit_id = ? AND year >= ? AND year <= ? ORDER BY year ASC";
+    case StatementId::SelectHabitYearsDesc:
+        return "SELECT year, days FROM habit_completion_years WHERE habit_id = ? ORDER BY year DESC";
+    case StatementId::UpsertHabitYear:
+        return "INSERT OR REPLACE INTO habit_completion_years (habit_id, year, days) VALUES (?, ?, ?)";
+    case StatementId::DeleteHabitYear:
+        return "DELETE FROM habit_completion_years WHERE habit_id = ? AND year = ?";
+    case StatementId::DeleteHabitYears:
+        return "DELETE FROM habit_completion_years WHERE habit_id = ?";
+    case StatementId::LatestHabitRun:
+        return "SELECT MAX(completion_date), COUNT(*) FROM ("
+               "SELECT completion_date, "
+               "julianday(completion_date) - ROW_NUMBER() OVER (ORDER BY completion_date) AS island "
+               "FROM habit_completions WHERE habit_id = ?) "
+               "GROUP BY island ORDER BY MAX(completion_date) DESC LIMIT 1";
+    case StatementId::SelectHabitStreak:
+        return "SELECT last_completion, streak_length FROM habit_streaks WHERE habit_id = ?";
+    case StatementId::UpsertHabitStreak:
+        return "INSERT OR REPLACE INTO habit_streaks (habit_id, last_completion, streak_length) VALUES (?, ?, ?)";
+    case StatementId::DeleteHabitStreak:
+        return "DELETE FROM habit_streaks WHERE habit_id = ?";
+    }
+    return QString();
+}
+
+// Выборка, прерванная до последней строки, должна вызвать finish(): активный оператор держит
+// открытой неявную транзакцию чтения, и соединение потока продолжает видеть старый снимок WAL.
+QSqlQuery& Database::cachedQuery(StatementId id)
+{
+    Connection& current = currentConnection();
+    CachedStatement& entry = current.statements[int(id)];
+    if (entry.prepared) {
+        ++cacheHits;
+        entry.query.finish();
+        return entry.query;
+    }
+    
+    ++cacheMisses;
+    entry.query = QSqlQuery(current.db);
+    entry.prepared = entry.query.prepare(statementSql(id));
+    if (!entry.prepared) {
+        qDebug() << "Ошибка подготовки запроса:" << entry.query.lastError().text();
+    }
+    
+    return entry.query;
+}
+
+// Вспомогательные запросы операции (журнал напоминаний, серия, годовые отметки) идут с
+// startsOperation = false: их ошибка приписывается операции, которую они дополняют.
+bool Database::execWrite(QSqlQuery& query, bool startsOperation)
+{
+    bool ok = query.exec();
+    
+    Connection& current = currentConnection();
+    if (current.inBatch) {
+        if (startsOperation) {
+            ++current.batch.operationCount;
+        }
+        if (!ok) {
+            current.batch.failures.push_back({qMax(current.batch.operationCount - 1, 0), query.lastError().text()});
+        }
+    }
+    
+    return ok;
+}
+
+// Операция, не дошедшая до записи (например, не прочиталось исходное состояние), тоже
+// считается в пакете и отменяет его.
+void Database::failOperation(const QString& error, bool startsOperation)
+{
+    Connection& current = currentConnection();
+    if (current.inBatch) {
+        if (startsOperation) {
+            ++current.batch.operationCount;
+        }
+        current.batch.failures.push_back({qMax(current.batch.operationCount - 1, 0), error});
+    }
+}
+
+void Database::notify(std::function<void()> notification)
+{
+    Connection& current = currentConnection();
+    if (current.inBatch) {
+        current.pendingNotifications.push_back(std::move(notification));
+    } else {
+        notification();
+    }
+}
+
+void Database::notifyTasksChanged(int userId, const QDate& date, bool recurring)
+{
+    Connection& current = currentConnection();
+    if (!current.inBatch) {
+        if (recurring) {
+            emit DatabaseNotifier::instance().taskSeriesChanged(userId, date);
+        } else {
+            emit DatabaseNotifier::instance().tasksChanged(userId, date);
+        }
+        return;
+    }
+    
+    if (recurring) {
+        QDate& from = current.pendingSeriesStarts[userId];
+        if (!from.isValid() || date < from) {
+            from = date;
+        }
+    } else {
+        current.pendingTaskDays.insert(qMakePair(userId, date));
+    }
+}
+
+void Database::clearPendingNotifications(Connection& connection)
+{
+    connection.pendingNotifications.clear();
+    connection.pendingTaskDays.clear();
+    connection.pendingSeriesStarts.clear();
+}
+
+bool Database::readTaskSchedule(int taskId, int& userId, QDate& date, bool& recurring)
+{
+    QSqlQuery& query = cachedQuery(StatementId::SelectTaskSchedule);
+    query.addBindValue(taskId);
+    
+    if (!query.exec() || !query.next()) {
+        return false;
+    }
+    
+    userId = query.value(0).toInt();
+    date = QDate::fromJulianDay(query.value(1).toLongLong());
+    recurring = query.value(2).toBool();
+    query.finish();
+    return true;
+}
+
 QString Database::hashPassword(const QString& password)
 {
     QCryptographicHash hash(QCryptographicHash::Sha256);
@@ -133,12 +497,13 @@ bool Database::createUser(const QString& username, const QString& password)
         return false;
     }
     
-    QSqlQuery query;
-    query.prepare("INSERT INTO users (username, password_hash) VALUES (?, ?)");
+    QMutexLocker writeLock(&writeMutex);
+    
+    QSqlQuery& query = cachedQuery(StatementId::InsertUser);
     query.addBindValue(username);
     query.addBindValue(hashPassword(password));
     
-    if (!query.exec()) {
+    if (!execWrite(query)) {
         qDebug() << "Ошибка создания пользователя:" << query.lastError().text();
         return false;
     }
@@ -149,8 +514,7 @@ bool Database::createUser(const QString& username, const QString& password)
 bool Database::authenticateUser(const QString& username, const QString& password)
 {
 
-    QSqlQuery query;
-    query.prepare("SELECT id, password_hash FROM users WHERE username = ?");
+    QSqlQuery& query = cachedQuery(StatementId::SelectUserByName);
     query.addBindValue(username);
     
     if (!query.exec() || !query.next()) {
@@ -159,6 +523,7 @@ bool Database::authenticateUser(const QString& username, const QString& password
     
     int userId = query.value(0).toInt();
     QString storedHash = query.value(1).toString();
+    query.finish();
     
     QString inputHash = hashPassword(password);
     
@@ -171,71 +536,94 @@ bool Database::authenticateUser(const QString& username, const QString& password
 }
 
 bool Database::createTask(int userId, const QString& title, const QDateTime& dateTime,
-                          bool isTimeBound, const QString& recurrence)
+                          bool isTimeBound, const RecurrenceRule& recurrence)
 {
-    QSqlQuery query;
-    query.prepare("INSERT INTO tasks (user_id, title, task_date, task_time, is_time_bound, recurrence) "
-                  "VALUES (?, ?, ?, ?, ?, ?)");
+    QMutexLocker writeLock(&writeMutex);
+    
+    QSqlQuery& query = cachedQuery(StatementId::InsertTask);
     query.addBindValue(userId);
     query.addBindValue(title);
-    query.addBindValue(dateTime.date());
-    query.addBindValue(isTimeBound ? dateTime.time() : QVariant());
+    query.addBindValue(RecordMapping::julianDayValue(dateTime.date()));
+    query.addBindValue(isTimeBound ? RecordMapping::minuteOfDayValue(dateTime.time()) : QVariant());
     query.addBindValue(isTimeBound ? 1 : 0);
-    query.addBindValue(recurrence.isEmpty() ? QVariant() : recurrence);
+    query.addBindValue(recurrence.isRecurring() ? QVariant(qint64(recurrence.code())) : QVariant());
     
-    if (!query.exec()) {
+    if (!execWrite(query)) {
         qDebug() << "Ошибка создания задачи:" << query.lastError().text();
         return false;
     }
     
+    notifyTasksChanged(userId, dateTime.date(), recurrence.isRecurring());
     return true;
 }
 
 bool Database::updateTask(int taskId, const QString& title, const QDateTime& dateTime,
-                          bool isTimeBound, const QString& recurrence)
+                          bool isTimeBound, const RecurrenceRule& recurrence)
 {
-    QSqlQuery query;
-    query.prepare("UPDATE tasks SET title = ?, task_date = ?, task_time = ?, "
-                  "is_time_bound = ?, recurrence = ? WHERE id = ?");
+    QMutexLocker writeLock(&writeMutex);
+    
+    // Старые день и правило нужны, чтобы сообщить и о дне, откуда задача ушла.
+    int userId = -1;
+    QDate oldDate;
+    bool wasRecurring = false;
+    bool known = readTaskSchedule(taskId, userId, oldDate, wasRecurring);
+    
+    QSqlQuery& query = cachedQuery(StatementId::UpdateTask);
     query.addBindValue(title);
-    query.addBindValue(dateTime.date());
-    query.addBindValue(isTimeBound ? dateTime.time() : QVariant());
+    query.addBindValue(RecordMapping::julianDayValue(dateTime.date()));
+    query.addBindValue(isTimeBound ? RecordMapping::minuteOfDayValue(dateTime.time()) : QVariant());
     query.addBindValue(isTimeBound ? 1 : 0);
-    query.addBindValue(recurrence.isEmpty() ? QVariant() : recurrence);
+    query.addBindValue(recurrence.isRecurring() ? QVariant(qint64(recurrence.code())) : QVariant());
     query.addBindValue(taskId);
     
-    if (!query.exec()) {
+    if (!execWrite(query)) {
         qDebug() << "Ошибка обновления задачи:" << query.lastError().text();
         return false;
     }
     
+    if (known) {
+        notifyTasksChanged(userId, oldDate, wasRecurring);
+        notifyTasksChanged(userId, dateTime.date(), recurrence.isRecurring());
+    }
     return true;
 }
 
 bool Database::deleteTask(int taskId)
 {
-    QSqlQuery query;
-    query.prepare("DELETE FROM tasks WHERE id = ?");
+    QMutexLocker writeLock(&writeMutex);
+    
+    int userId = -1;
+    QDate date;
+    bool recurring = false;
+    bool known = readTaskSchedule(taskId, userId, date, recurring);
+    
+    QSqlQuery& query = cachedQuery(StatementId::DeleteTask);
     query.addBindValue(taskId);
     
-    if (!query.exec()) {
+    if (!execWrite(query)) {
         qDebug() << "Ошибка удаления задачи:" << query.lastError().text();
         return false;
     }
     
+    QSqlQuery& deliveriesQuery = cachedQuery(StatementId::DeleteTaskDeliveries);
+    deliveriesQuery.addBindValue(taskId);
+    if (!execWrite(deliveriesQuery, false)) {
+        qDebug() << "Ошибка удаления журнала напоминаний:" << deliveriesQuery.lastError().text();
+    }
+    
+    if (known) {
+        notifyTasksChanged(userId, date, recurring);
+    }
     return true;
 }
 
-QList<QHash<QString, QVariant>> Database::getTasksForDay(int userId, const QDate& date)
+std::vector<TaskRecord> Database::getTasksForDay(int userId, const QDate& date)
 {
-    QList<QHash<QString, QVariant>> tasks;
+    std::vector<TaskRecord> tasks;
     
-    QSqlQuery query;
-    query.prepare("SELECT id, title, task_date, task_time, is_time_bound, recurrence "
-                  "FROM tasks WHERE user_id = ? AND task_date = ? "
-                  "ORDER BY is_time_bound DESC, task_time ASC");
+    QSqlQuery& query = cachedQuery(StatementId::TasksForDay);
     query.addBindValue(userId);
-    query.addBindValue(date);
+    query.addBindValue(RecordMapping::julianDayValue(date));
     
     if (!query.exec()) {
         qDebug() << "Ошибка получения задач:" << query.lastError().text();
@@ -243,31 +631,27 @@ QList<QHash<QString, QVariant>> Database::getTasksForDay(int userId, const QDate
     }
     
     while (query.next()) {
-        QHash<QString, QVariant> task;
-        task["id"] = query.value(0);
-        task["title"] = query.value(1);
-        task["task_date"] = query.value(2);
-        task["task_time"] = query.value(3);
-        task["is_time_bound"] = query.value(4).toBool();
-        task["recurrence"] = query.value(5);
-        tasks.append(task);
+        tasks.push_back(readRecord<TaskRecord>(query));
+    }
+    
+    std::vector<TaskRecord> occurrences = getRecurringOccurrences(userId, date, date.addDays(1));
+    if (!occurrences.empty()) {
+        tasks.insert(tasks.end(), occurrences.begin(), occurrences.end());
+        sortTasks(tasks);
     }
     
     return tasks;
 }
 
-QList<QHash<QString, QVariant>> Database::getTasksForWeek(int userId, const QDate& weekStart)
+std::vector<TaskRecord> Database::getTasksForWeek(int userId, const QDate& weekStart)
 {
-    QList<QHash<QString, QVariant>> tasks;
+    std::vector<TaskRecord> tasks;
     QDate weekEnd = weekStart.addDays(6);
     
-    QSqlQuery query;
-    query.prepare("SELECT id, title, task_date, task_time, is_time_bound, recurrence "
-                  "FROM tasks WHERE user_id = ? AND task_date >= ? AND task_date <= ? "
-                  "ORDER BY task_date ASC, is_time_bound DESC, task_time ASC");
+    QSqlQuery& query = cachedQuery(StatementId::TasksForWeek);
     query.addBindValue(userId);
-    query.addBindValue(weekStart);
-    query.addBindValue(weekEnd);
+    query.addBindValue(RecordMapping::julianDayValue(weekStart));
+    query.addBindValue(RecordMapping::julianDayValue(weekEnd));
     
     if (!query.exec()) {
         qDebug() << "Ошибка выборки задач на неделю:" << query.lastError().text();
@@ -275,86 +659,397 @@ QList<QHash<QString, QVariant>> Database::getTasksForWeek(int userId, const QDat
     }
     
     while (query.next()) {
-        QHash<QString, QVariant> task;
-        task["id"] = query.value(0);
-        task["title"] = query.value(1);
-        task["task_date"] = query.value(2);
-        task["task_time"] = query.value(3);
-        task["is_time_bound"] = query.value(4).toBool();
-        task["recurrence"] = query.value(5);
-        tasks.append(task);
+        tasks.push_back(readRecord<TaskRecord>(query));
+    }
+    
+    std::vector<TaskRecord> occurrences = getRecurringOccurrences(userId, weekStart, weekEnd.addDays(1));
+    if (!occurrences.empty()) {
+        tasks.insert(tasks.end(), occurrences.begin(), occurrences.end());
+        sortTasks(tasks);
     }
     
     return tasks;
 }
 
-void Database::cleanupOldData(int userId, const QDate& currentWeekStart)
+QHash<QDate, std::vector<TaskRecord>> Database::getTasksForRange(int userId, const QDate& from, const QDate& to,
+                                                                 bool *ok)
 {
+    QHash<QDate, std::vector<TaskRecord>> tasksByDate;
+    if (ok) {
+        *ok = false;
+    }
+    
+    QSqlQuery& query = cachedQuery(StatementId::TasksForRange);
+    query.addBindValue(userId);
+    query.addBindValue(RecordMapping::julianDayValue(from));
+    query.addBindValue(RecordMapping::julianDayValue(to));
+    
+    if (!query.exec()) {
+        qDebug() << "Ошибка выборки задач за период:" << query.lastError().text();
+        return tasksByDate;
+    }
+    
+    while (query.next()) {
+        TaskRecord task = readRecord<TaskRecord>(query);
+        tasksByDate[task.date].push_back(std::move(task));
+    }
+    
+    bool occurrencesOk = false;
+    std::vector<TaskRecord> occurrences = getRecurringOccurrences(userId, from, to.addDays(1), &occurrencesOk);
+    if (!occurrencesOk) {
+        return QHash<QDate, std::vector<TaskRecord>>();
+    }
+    
+    QSet<QDate> touchedDates;
+    for (TaskRecord& occurrence : occurrences) {
+        touchedDates.insert(occurrence.date);
+        tasksByDate[occurrence.date].push_back(std::move(occurrence));
+    }
+    for (const QDate& date : touchedDates) {
+        sortTasks(tasksByDate[date]);
+    }
+    
+    if (ok) {
+        *ok = true;
+    }
+    return tasksByDate;
+}
 
-    QDate threeWeeksAgo = currentWeekStart.addDays(-21);
+std::vector<TaskRecord> Database::getRecurringOccurrences(int userId, const QDate& from, const QDate& to, bool *ok)
+{
+    std::vector<TaskRecord> occurrences;
+    if (ok) {
+        *ok = false;
+    }
     
-    QSqlQuery query;
-    query.prepare("DELETE FROM tasks WHERE user_id = ? AND task_date < ?");
+    QSqlQuery& query = cachedQuery(StatementId::RecurringTasks);
     query.addBindValue(userId);
-    query.addBindValue(threeWeeksAgo);
+    query.addBindValue(RecordMapping::julianDayValue(to));
     
     if (!query.exec()) {
+        qDebug() << "Ошибка выборки повторяющихся задач:" << query.lastError().text();
+        return occurrences;
+    }
+    
+    while (query.next()) {
+        TaskRecord series = readRecord<TaskRecord>(query);
+        const RecurrenceRule& rule = series.recurrence;
+        QTime startTime = series.isTimeBound ? series.time : QTime();
+        
+        rule.forEachOccurrence(series.date, startTime, from, to,
+                               [&occurrences, &series](const QDate& date, const QTime& time) {
+            TaskRecord occurrence = series;
+            occurrence.date = date;
+            occurrence.time = time;
+            occurrence.seriesDate = series.date;
+            occurrence.seriesTime = series.time;
+            occurrences.push_back(std::move(occurrence));
+        });
+    }
+    
+    if (ok) {
+        *ok = true;
+    }
+    return occurrences;
+}
+
+// Номер минуты от начала юлианского календаря, как в выражении task_day * 1440 + task_minute.
+// Неполная минута округляется вверх: от момента 09:59:30 задача в 10:00 ещё впереди, от 10:00:30 — уже нет.
+qint64 Database::minuteStamp(const QDateTime& dateTime)
+{
+    return dateTime.date().toJulianDay() * MinutesPerDay
+           + (dateTime.time().msecsSinceStartOfDay() + 59999) / 60000;
+}
+
+// Срок задачи в тех же единицах, что task_day * 1440 + task_minute.
+qint64 Database::dueStamp(const QDate& date, const QTime& time)
+{
+    return date.toJulianDay() * MinutesPerDay + time.msecsSinceStartOfDay() / 60000;
+}
+
+void Database::sortTasks(std::vector<TaskRecord>& tasks)
+{
+    std::stable_sort(tasks.begin(), tasks.end(), [](const TaskRecord& a, const TaskRecord& b) {
+        if (a.date != b.date) {
+            return a.date < b.date;
+        }
+        if (a.isTimeBound != b.isTimeBound) {
+            return a.isTimeBound;
+        }
+        return a.time < b.time;
+    });
+}
+
+bool Database::beginBatch()
+{
+    Connection& current = currentConnection();
+    if (current.inBatch) {
+        qDebug() << "Пакетная запись уже начата в этом потоке";
+        return false;
+    }
+    
+    writeMutex.lock();
+    if (!current.db.transaction()) {
+        qDebug() << "Ошибка начала пакетной записи:" << current.db.lastError().text();
+        writeMutex.unlock();
+        return false;
+    }
+    
+    current.inBatch = true;
+    current.batch = BatchResult();
+    return true;
+}
+
+Database::BatchResult Database::commitBatch()
+{
+    Connection& current = currentConnection();
+    if (!current.inBatch) {
+        return BatchResult();
+    }
+    
+    BatchResult result = std::move(current.batch);
+    std::vector<std::function<void()>> notifications = std::move(current.pendingNotifications);
+    QSet<QPair<int, QDate>> taskDays = std::move(current.pendingTaskDays);
+    QHash<int, QDate> seriesStarts = std::move(current.pendingSeriesStarts);
+    current.inBatch = false;
+    current.batch = BatchResult();
+    clearPendingNotifications(current);
+    
+    if (result.failures.empty()) {
+        result.committed = current.db.commit();
+        if (!result.committed) {
+            qDebug() << "Ошибка фиксации пакетной записи:" << current.db.lastError().text();
+            current.db.rollback();
+        }
+    } else {
+        qDebug() << "Пакетная запись отменена, ошибок:" << result.failures.size();
+        current.db.rollback();
+    }
+    
+    writeMutex.unlock();
+    
+    if (result.committed) {
+        DatabaseNotifier& notifier = DatabaseNotifier::instance();
+        for (auto it = seriesStarts.constBegin(); it != seriesStarts.constEnd(); ++it) {
+            emit notifier.taskSeriesChanged(it.key(), it.value());
+        }
+        // Дни, которые уже покрыты изменением серии, отдельно не сообщаются.
+        for (const QPair<int, QDate>& day : taskDays) {
+            QDate seriesFrom = seriesStarts.value(day.first);
+            if (!seriesFrom.isValid() || day.second < seriesFrom) {
+                emit notifier.tasksChanged(day.first, day.second);
+            }
+        }
+        for (const std::function<void()>& notification : notifications) {
+            notification();
+        }
+    }
+    return result;
+}
+
+void Database::rollbackBatch()
+{
+    Connection& current = currentConnection();
+    if (!current.inBatch) {
+        return;
+    }
+    
+    current.db.rollback();
+    current.inBatch = false;
+    current.batch = BatchResult();
+    clearPendingNotifications(current);
+    writeMutex.unlock();
+}
+
+Database::BatchResult Database::createTasks(int userId, const std::vector<TaskRecord>& tasks)
+{
+    if (!beginBatch()) {
+        return BatchResult();
+    }
+    
+    for (const TaskRecord& task : tasks) {
+        createTask(userId, task.title, QDateTime(task.date, task.isTimeBound ? task.time : QTime()),
+                   task.isTimeBound, task.recurrence);
+    }
+    
+    return commitBatch();
+}
+
+int Database::cleanupOldData(int userId, const QDate& currentWeekStart)
+{
+    QMutexLocker writeLock(&writeMutex);
+
+    QDate threeWeeksAgo = currentWeekStart.addDays(-RetentionDays);
+    
+    QSqlQuery& query = cachedQuery(StatementId::DeleteOldTasks);
+    query.addBindValue(userId);
+    query.addBindValue(RecordMapping::julianDayValue(threeWeeksAgo));
+    
+    int removed = 0;
+    if (!execWrite(query)) {
         qDebug() << "Ошибка очистки старых данных:" << query.lastError().text();
+    } else {
+        removed = query.numRowsAffected();
+    }
+    
+    QSqlQuery& deliveriesQuery = cachedQuery(StatementId::DeleteOldDeliveries);
+    deliveriesQuery.addBindValue(threeWeeksAgo.toJulianDay() * MinutesPerDay);
+    if (!execWrite(deliveriesQuery, false)) {
+        qDebug() << "Ошибка очистки журнала напоминаний:" << deliveriesQuery.lastError().text();
+    }
+    
+    return removed;
+}
+
+std::vector<TaskRecord> Database::getPendingReminders(int userId, const QDateTime& from, const QDateTime& to)
+{
+    std::vector<TaskRecord> tasks;
+    qint64 fromStamp = minuteStamp(from);
+    qint64 toStamp = minuteStamp(to);
+    
+    QSqlQuery& query = cachedQuery(StatementId::PendingReminders);
+    query.addBindValue(userId);
+    query.addBindValue(RecordMapping::julianDayValue(from.date()));
+    query.addBindValue(RecordMapping::julianDayValue(to.date()));
+    query.addBindValue(fromStamp);
+    query.addBindValue(toStamp);
+    
+    if (!query.exec()) {
+        qDebug() << "Ошибка получения напоминаний:" << query.lastError().text();
+        return tasks;
+    }
+    
+    while (query.next()) {
+        tasks.push_back(readRecord<TaskRecord>(query));
+    }
+    
+    // Повторения серий разворачиваются так же, как для представлений; доставка каждого
+    // повторения записана в журнале под его собственной минутой.
+    QSqlQuery& deliveredQuery = cachedQuery(StatementId::DeliveredOccurrences);
+    deliveredQuery.addBindValue(userId);
+    deliveredQuery.addBindValue(fromStamp);
+    deliveredQuery.addBindValue(toStamp);
+    
+    if (!deliveredQuery.exec()) {
+        qDebug() << "Ошибка получения журнала напоминаний:" << deliveredQuery.lastError().text();
+        return tasks;
+    }
+    
+    QSet<QPair<int, qint64>> delivered;
+    while (deliveredQuery.next()) {
+        delivered.insert(qMakePair(deliveredQuery.value(0).toInt(), deliveredQuery.value(1).toLongLong()));
+    }
+    
+    bool hasOccurrences = false;
+    for (TaskRecord& occurrence : getRecurringOccurrences(userId, from.date(), to.date().addDays(1))) {
+        if (!occurrence.isTimeBound || !occurrence.time.isValid()) {
+            continue;
+        }
+        
+        qint64 due = dueStamp(occurrence.date, occurrence.time);
+        if (due < fromStamp || due >= toStamp || delivered.contains(qMakePair(occurrence.id, due))) {
+            continue;
+        }
+        
+        tasks.push_back(std::move(occurrence));
+        hasOccurrences = true;
+    }
+    
+    if (hasOccurrences) {
+        sortTasks(tasks);
+    }
+    
+    return tasks;
+}
+
+bool Database::recordReminderDelivery(int taskId, const QDateTime& dueAt)
+{
+    QMutexLocker writeLock(&writeMutex);
+    
+    QSqlQuery& query = cachedQuery(StatementId::InsertReminderDelivery);
+    query.addBindValue(taskId);
+    query.addBindValue(dueStamp(dueAt.date(), dueAt.time()));
+    
+    if (!execWrite(query)) {
+        qDebug() << "Ошибка записи журнала напоминаний:" << query.lastError().text();
+        return false;
     }
+    
+    return true;
 }
 
 int Database::createNote(int userId, const QString& name, const QString& content)
 {
-    QSqlQuery query;
-    query.prepare("INSERT INTO notes (user_id, name, content) VALUES (?, ?, ?)");
+    QMutexLocker writeLock(&writeMutex);
+    
+    QSqlQuery& query = cachedQuery(StatementId::InsertNote);
     query.addBindValue(userId);
     query.addBindValue(name);
     query.addBindValue(content);
     
-    if (!query.exec()) {
+    if (!execWrite(query)) {
         qDebug() << "Ошибка создания заметки:" << query.lastError().text();
         return -1;
     }
     
-    return query.lastInsertId().toInt();
+    int noteId = query.lastInsertId().toInt();
+    notify([noteId]() {
+        emit DatabaseNotifier::instance().noteChanged(noteId);
+    });
+    return noteId;
 }
 
 bool Database::updateNote(int noteId, const QString& name, const QString& content)
 {
-    QSqlQuery query;
-    query.prepare("UPDATE notes SET name = ?, content = ?, updated_at = CURRENT_TIMESTAMP WHERE id = ?");
+    QMutexLocker writeLock(&writeMutex);
+    
+    QSqlQuery& query = cachedQuery(StatementId::UpdateNote);
     query.addBindValue(name);
     query.addBindValue(content);
     query.addBindValue(noteId);
     
-    if (!query.exec()) {
+    if (!execWrite(query)) {
         qDebug() << "Ошибка обновления заметки:" << query.lastError().text();
         return false;
     }
     
-    return query.numRowsAffected() > 0;
+    if (query.numRowsAffected() <= 0) {
+        return false;
+    }
+    
+    notify([noteId]() {
+        emit DatabaseNotifier::instance().noteChanged(noteId);
+    });
+    return true;
 }
 
 bool Database::deleteNote(int noteId)
 {
-    QSqlQuery query;
-    query.prepare("DELETE FROM notes WHERE id = ?");
+    QMutexLocker writeLock(&writeMutex);
+    
+    QSqlQuery& query = cachedQuery(StatementId::DeleteNote);
     query.addBindValue(noteId);
     
-    if (!query.exec()) {
+    if (!execWrite(query)) {
         qDebug() << "Ошибка удаления заметки:" << query.lastError().text();
         return false;
     }
     
-    return query.numRowsAffected() > 0;
+    if (query.numRowsAffected() <= 0) {
+        return false;
+    }
+    
+    notify([noteId]() {
+        emit DatabaseNotifier::instance().noteChanged(noteId);
+    });
+    return true;
 }
 
-QList<QHash<QString, QVariant>> Database::getNotes(int userId)
+std::vector<NoteRecord> Database::getNotes(int userId)
 {
-    QList<QHash<QString, QVariant>> notes;
+    std::vector<NoteRecord> notes;
     
-    QSqlQuery query;
-    query.prepare("SELECT id, name, content, created_at, updated_at FROM notes WHERE user_id = ? ORDER BY updated_at DESC");
+    QSqlQuery& query = cachedQuery(StatementId::SelectNotes);
     query.addBindValue(userId);
     
     if (!query.exec()) {
@@ -363,24 +1058,17 @@ QList<QHash<QString, QVariant>> Database::getNotes(int userId)
     }
     
     while (query.next()) {
-        QHash<QString, QVariant> note;
-        note["id"] = query.value(0);
-        note["name"] = query.value(1);
-        note["content"] = query.value(2);
-        note["created_at"] = query.value(3);
-        note["updated_at"] = query.value(4);
-        notes.append(note);
+        notes.push_back(readRecord<NoteRecord>(query));
     }
     
     return notes;
 }
 
-QHash<QString, QVariant> Database::getNote(int noteId)
+NoteRecord Database::getNote(int noteId)
 {
-    QHash<QString, QVariant> note;
+    NoteRecord note;
     
-    QSqlQuery query;
-    query.prepare("SELECT id, user_id, name, content, created_at, updated_at FROM notes WHERE id = ?");
+    QSqlQuery& query = cachedQuery(StatementId::SelectNote);
     query.addBindValue(noteId);
     
     if (!query.exec()) {
@@ -389,12 +1077,8 @@ QHash<QString, QVariant> Database::getNote(int noteId)
     }
     
     if (query.next()) {
-        note["id"] = query.value(0);
-        note["user_id"] = query.value(1);
-        note["name"] = query.value(2);
-        note["content"] = query.value(3);
-        note["created_at"] = query.value(4);
-        note["updated_at"] = query.value(5);
+        note = readRecord<NoteRecord>(query);
+        query.finish();
     }
     
     return note;
@@ -402,12 +1086,13 @@ QHash<QString, QVariant> Database::getNote(int noteId)
 
 int Database::createHabit(int userId, const QString& name)
 {
-    QSqlQuery query;
-    query.prepare("INSERT INTO habits (user_id, name) VALUES (?, ?)");
+    QMutexLocker writeLock(&writeMutex);
+    
+    QSqlQuery& query = cachedQuery(StatementId::InsertHabit);
     query.addBindValue(userId);
     query.addBindValue(name);
     
-    if (!query.exec()) {
+    if (!execWrite(query)) {
         qDebug() << "Ошибка создания привычки:" << query.lastError().text();
         return -1;
     }
@@ -417,24 +1102,38 @@ int Database::createHabit(int userId, const QString& name)
 
 bool Database::deleteHabit(int habitId)
 {
-    QSqlQuery query;
-    query.prepare("DELETE FROM habits WHERE id = ?");
+    QMutexLocker writeLock(&writeMutex);
+    
+    QSqlQuery& query = cachedQuery(StatementId::DeleteHabit);
     query.addBindValue(habitId);
     
-    if (!query.exec()) {
+    if (!execWrite(query)) {
         qDebug() << "Ошибка удаления:" << query.lastError().text();
         return false;
     }
     
-    return query.numRowsAffected() > 0;
+    bool deleted = query.numRowsAffected() > 0;
+    
+    QSqlQuery& yearsQuery = cachedQuery(StatementId::DeleteHabitYears);
+    yearsQuery.addBindValue(habitId);
+    if (!execWrite(yearsQuery, false)) {
+        qDebug() << "Ошибка удаления отметок привычки:" << yearsQuery.lastError().text();
+    }
+    
+    QSqlQuery& streakQuery = cachedQuery(StatementId::DeleteHabitStreak);
+    streakQuery.addBindValue(habitId);
+    if (!execWrite(streakQuery, false)) {
+        qDebug() << "Ошибка удаления серии привычки:" << streakQuery.lastError().text();
+    }
+    
+    return deleted;
 }
 
-QList<QHash<QString, QVariant>> Database::getHabits(int userId)
+std::vector<HabitRecord> Database::getHabits(int userId)
 {
-    QList<QHash<QString, QVariant>> habits;
+    std::vector<HabitRecord> habits;
     
-    QSqlQuery query;
-    query.prepare("SELECT id, name, created_at FROM habits WHERE user_id = ? ORDER BY created_at DESC");
+    QSqlQuery& query = cachedQuery(StatementId::SelectHabits);
     query.addBindValue(userId);
     
     if (!query.exec()) {
@@ -443,11 +1142,7 @@ QList<QHash<QString, QVariant>> Database::getHabits(int userId)
     }
     
     while (query.next()) {
-        QHash<QString, QVariant> habit;
-        habit["id"] = query.value(0);
-        habit["name"] = query.value(1);
-        habit["created_at"] = query.value(2);
-        habits.append(habit);
+        habits.push_back(readRecord<HabitRecord>(query));
     }
     
     return habits;
@@ -455,38 +1150,117 @@ QList<QHash<QString, QVariant>> Database::getHabits(int userId)
 
 bool Database::markHabitCompleted(int habitId, const QDate& date)
 {
-    QSqlQuery query;
-    query.prepare("INSERT OR IGNORE INTO habit_completions (habit_id, completion_date) VALUES (?, ?)");
-    query.addBindValue(habitId);
-    query.addBindValue(date);
+    QMutexLocker writeLock(&writeMutex);
+    Connection& current = currentConnection();
+    QSqlDatabase& db = current.db;
+    // Внутри пакета транзакция уже открыта, и за откат отвечает commitBatch().
+    bool ownsTransaction = !current.inBatch && db.transaction();
+    bool marked = false;
+    
+    if (habitStorage == HabitStorage::Bitmap) {
+        if (!setHabitDay(habitId, date, true, marked)) {
+            if (ownsTransaction) {
+                db.rollback();
+            }
+            return false;
+        }
+    } else {
+        QSqlQuery& query = cachedQuery(StatementId::MarkHabitCompleted);
+        query.addBindValue(habitId);
+        query.addBindValue(date);
+        
+        if (!execWrite(query)) {
+            qDebug() << "Ошибка при попытке пометить задачу как выполненную:" << query.lastError().text();
+            if (ownsTransaction) {
+                db.rollback();
+            }
+            return false;
+        }
+        
+        marked = query.numRowsAffected() > 0;
+    }
     
-    if (!query.exec()) {
-        qDebug() << "Ошибка при попытке пометить задачу как выполненную:" << query.lastError().text();
+    if (marked && !updateHabitStreak(habitId, date, true)) {
+        if (ownsTransaction) {
+            db.rollback();
+        }
+        return false;
+    }
+    
+    if (ownsTransaction && !db.commit()) {
+        qDebug() << "Ошибка фиксации отметки привычки:" << db.lastError().text();
+        db.rollback();
         return false;
     }
     
-    return query.numRowsAffected() > 0;
+    if (marked) {
+        notify([habitId, date]() {
+            emit DatabaseNotifier::instance().habitCompletionChanged(habitId, date, true);
+        });
+    }
+    return true;
 }
 
 bool Database::unmarkHabitCompleted(int habitId, const QDate& date)
 {
-    QSqlQuery query;
-    query.prepare("DELETE FROM habit_completions WHERE habit_id = ? AND completion_date = ?");
-    query.addBindValue(habitId);
-    query.addBindValue(date);
+    QMutexLocker writeLock(&writeMutex);
+    Connection& current = currentConnection();
+    QSqlDatabase& db = current.db;
+    bool ownsTransaction = !current.inBatch && db.transaction();
+    bool unmarked = false;
+    
+    if (habitStorage == HabitStorage::Bitmap) {
+        if (!setHabitDay(habitId, date, false, unmarked)) {
+            if (ownsTransaction) {
+                db.rollback();
+            }
+            return false;
+        }
+    } else {
+        QSqlQuery& query = cachedQuery(StatementId::UnmarkHabitCompleted);
+        query.addBindValue(habitId);
+        query.addBindValue(date);
+        
+        if (!execWrite(query)) {
+            qDebug() << "Стираем отметку о выполнении:" << query.lastError().text();
+            if (ownsTransaction) {
+                db.rollback();
+            }
+            return false;
+        }
+        
+        unmarked = query.numRowsAffected() > 0;
+    }
     
-    if (!query.exec()) {
-        qDebug() << "Стираем отметку о выполнении:" << query.lastError().text();
+    if (unmarked && !updateHabitStreak(habitId, date, false)) {
+        if (ownsTransaction) {
+            db.rollback();
+        }
+        return false;
+    }
+    
+    if (ownsTransaction && !db.commit()) {
+        qDebug() << "Ошибка фиксации отметки привычки:" << db.lastError().text();
+        db.rollback();
         return false;
     }
     
-    return query.numRowsAffected() > 0;
+    if (unmarked) {
+        notify([habitId, date]() {
+            emit DatabaseNotifier::instance().habitCompletionChanged(habitId, date, false);
+        });
+    }
+    return true;
 }
 
 bool Database::isHabitCompleted(int habitId, const QDate& date)
 {
-    QSqlQuery query;
-    query.prepare("SELECT COUNT(*) FROM habit_completions WHERE habit_id = ? AND completion_date = ?");
+    if (habitStorage == HabitStorage::Bitmap) {
+        HabitYearBitmap days;
+        return loadHabitYear(habitId, date.year(), days) && days.test(date.dayOfYear() - 1);
+    }
+    
+    QSqlQuery& query = cachedQuery(StatementId::IsHabitCompleted);
     query.addBindValue(habitId);
     query.addBindValue(date);
     
@@ -494,21 +1268,44 @@ bool Database::isHabitCompleted(int habitId, const QDate& date)
         return false;
     }
     
-    return query.value(0).toInt() > 0;
+    bool completed = query.value(0).toInt() > 0;
+    query.finish();
+    return completed;
 }
 
-QList<QDate> Database::getHabitCompletionsForMonth(int habitId, int year, int month)
+QList<QDate> Database::getHabitCompletions(int habitId, const QDate& from, const QDate& to)
 {
     QList<QDate> dates;
     
-    QSqlQuery query;
-    query.prepare("SELECT completion_date FROM habit_completions WHERE habit_id = ? AND strftime('%Y', completion_date) = ? AND strftime('%m', completion_date) = ?");
+    if (habitStorage == HabitStorage::Bitmap) {
+        QSqlQuery& query = cachedQuery(StatementId::SelectHabitYearsInRange);
+        query.addBindValue(habitId);
+        query.addBindValue(from.year());
+        query.addBindValue(to.addDays(-1).year());
+        
+        if (!query.exec()) {
+            qDebug() << "Ошибка выборки выполнений за период:" << query.lastError().text();
+            return dates;
+        }
+        
+        while (query.next()) {
+            QDate firstDay(query.value(0).toInt(), 1, 1);
+            HabitYearBitmap days = HabitYearBitmap::fromBlob(query.value(1).toByteArray());
+            days.forEachSetDay(int(firstDay.daysTo(from)), int(firstDay.daysTo(to)), [&](int day) {
+                dates.append(firstDay.addDays(day));
+            });
+        }
+        
+        return dates;
+    }
+    
+    QSqlQuery& query = cachedQuery(StatementId::HabitCompletionsInRange);
     query.addBindValue(habitId);
-    query.addBindValue(QString::number(year));
-    query.addBindValue(QString::number(month).rightJustified(2, '0'));
+    query.addBindValue(from);
+    query.addBindValue(to);
     
     if (!query.exec()) {
-        qDebug() << "Ошибка подсчёта выполнений за месяц:" << query.lastError().text();
+        qDebug() << "Ошибка выборки выполнений за период:" << query.lastError().text();
         return dates;
     }
     
@@ -518,3 +1315,412 @@ QList<QDate> Database::getHabitCompletionsForMonth(int habitId, int year, int mo
     
     return dates;
 }
+
+QList<QDate> Database::getHabitCompletionsForMonth(int habitId, int year, int month)
+{
+    QDate firstDay(year, month, 1);
+    return getHabitCompletions(habitId, firstDay, firstDay.addMonths(1));
+}
+
+int Database::getHabitCompletionCount(int habitId, const QDate& from, const QDate& to)
+{
+    if (habitStorage == HabitStorage::Bitmap) {
+        QSqlQuery& query = cachedQuery(StatementId::SelectHabitYearsInRange);
+        query.addBindValue(habitId);
+        query.addBindValue(from.year());
+        query.addBindValue(to.addDays(-1).year());
+        
+        if (!query.exec()) {
+            qDebug() << "Ошибка подсчёта выполнений за период:" << query.lastError().text();
+            return 0;
+        }
+        
+        int total = 0;
+        while (query.next()) {
+            QDate firstDay(query.value(0).toInt(), 1, 1);
+            HabitYearBitmap days = HabitYearBitmap::fromBlob(query.value(1).toByteArray());
+            total += days.count(int(firstDay.daysTo(from)), int(firstDay.daysTo(to)));
+        }
+        
+        return total;
+    }
+    
+    QSqlQuery& query = cachedQuery(StatementId::HabitCompletionCount);
+    query.addBindValue(habitId);
+    query.addBindValue(from);
+    query.addBindValue(to);
+    
+    if (!query.exec() || !query.next()) {
+        return 0;
+    }
+    
+    int count = query.value(0).toInt();
+    query.finish();
+    return count;
+}
+
+int Database::getCurrentStreak(int habitId)
+{
+    return getHabitStreak(habitId).currentLength(QDate::currentDate());
+}
+
+HabitStreak Database::getHabitStreak(int habitId)
+{
+    HabitStreak streak;
+    if (!loadHabitStreak(habitId, streak)) {
+        QMutexLocker writeLock(&writeMutex);
+        if (computeHabitStreak(habitId, streak)) {
+            storeHabitStreak(habitId, streak);
+        }
+    }
+    
+    return streak;
+}
+
+bool Database::computeHabitStreak(int habitId, HabitStreak& streak)
+{
+    if (habitStorage == HabitStorage::Bitmap) {
+        return computeHabitStreakFromBitmaps(habitId, streak);
+    }
+    
+    streak = HabitStreak();
+    
+    QSqlQuery& query = cachedQuery(StatementId::LatestHabitRun);
+    query.addBindValue(habitId);
+    
+    if (!query.exec()) {
+        qDebug() << "Ошибка подсчёта серии привычки:" << query.lastError().text();
+        return false;
+    }
+    
+    if (query.next()) {
+        streak.lastCompletion = query.value(0).toDate();
+        streak.length = query.value(1).toInt();
+        query.finish();
+    }
+    
+    return true;
+}
+
+bool Database::loadHabitStreak(int habitId, HabitStreak& streak)
+{
+    QSqlQuery& query = cachedQuery(StatementId::SelectHabitStreak);
+    query.addBindValue(habitId);
+    
+    if (!query.exec() || !query.next()) {
+        return false;
+    }
+    
+    streak.lastCompletion = query.value(0).toDate();
+    streak.length = query.value(1).toInt();
+    query.finish();
+    return true;
+}
+
+bool Database::storeHabitStreak(int habitId, const HabitStreak& streak)
+{
+    QSqlQuery& query = cachedQuery(StatementId::UpsertHabitStreak);
+    query.addBindValue(habitId);
+    query.addBindValue(streak.lastCompletion.isValid() ? QVariant(streak.lastCompletion) : QVariant());
+    query.addBindValue(streak.length);
+    
+    if (!execWrite(query, false)) {
+        qDebug() << "Ошибка сохранения серии привычки:" << query.lastError().text();
+        return false;
+    }
+    
+    return true;
+}
+
+// Кэш серии строится на предыдущем значении, поэтому при ошибке отметка не должна фиксироваться:
+// иначе неверная серия так и осталась бы в habit_streaks.
+bool Database::updateHabitStreak(int habitId, const QDate& date, bool completed)
+{
+    HabitStreak streak;
+    bool updated = loadHabitStreak(habitId, streak);
+    if (updated) {
+        updated = completed ? streak.applyMark(date) : streak.applyUnmark(date);
+    }
+    
+    if (!updated && !computeHabitStreak(habitId, streak)) {
+        failOperation("Не удалось пересчитать серию привычки", false);
+        return false;
+    }
+    
+    return storeHabitStreak(habitId, streak);
+}
+
+bool Database::computeHabitStreakFromBitmaps(int habitId, HabitStreak& streak)
+{
+    streak = HabitStreak();
+    
+    QSqlQuery& query = cachedQuery(StatementId::SelectHabitYearsDesc);
+    query.addBindValue(habitId);
+    
+    if (!query.exec()) {
+        qDebug() << "Ошибка подсчёта серии привычки:" << query.lastError().text();
+        return false;
+    }
+    
+    int expectedYear = 0;
+    while (query.next()) {
+        int year = query.value(0).toInt();
+        HabitYearBitmap days = HabitYearBitmap::fromBlob(query.value(1).toByteArray());
+        
+        int lastDay;
+        if (!streak.lastCompletion.isValid()) {
+            lastDay = days.lastSetDay();
+            if (lastDay < 0) {
+                continue;
+            }
+            streak.lastCompletion = QDate(year, 1, 1).addDays(lastDay);
+        } else {
+            if (year != expectedYear) {
+                break;
+            }
+            lastDay = QDate(year, 1, 1).daysInYear() - 1;
+        }
+        
+        int run = days.runEndingAt(lastDay);
+        streak.length += run;
+        if (run != lastDay + 1) {
+            break;
+        }
+        expectedYear = year - 1;
+    }
+    query.finish();
+    
+    return true;
+}
+
+// Для года без строки — пустая карта; false только при ошибке чтения, иначе запись поверх
+// пустой карты стёрла бы остальные отметки года.
+bool Database::loadHabitYear(int habitId, int year, HabitYearBitmap& days)
+{
+    QSqlQuery& query = cachedQuery(StatementId::SelectHabitYear);
+    query.addBindValue(habitId);
+    query.addBindValue(year);
+    
+    if (!query.exec()) {
+        qDebug() << "Ошибка чтения отметок привычки:" << query.lastError().text();
+        return false;
+    }
+    
+    days = query.next() ? HabitYearBitmap::fromBlob(query.value(0).toByteArray()) : HabitYearBitmap();
+    query.finish();
+    return true;
+}
+
+bool Database::storeHabitYear(int habitId, int year, const HabitYearBitmap& days)
+{
+    QSqlQuery& query = cachedQuery(days.isEmpty() ? StatementId::DeleteHabitYear
+                                                  : StatementId::UpsertHabitYear);
+    query.addBindValue(habitId);
+    query.addBindValue(year);
+    if (!days.isEmpty()) {
+        query.addBindValue(days.toBlob());
+    }
+    
+    if (!execWrite(query)) {
+        qDebug() << "Ошибка сохранения отметок привычки:" << query.lastError().text();
+        return false;
+    }
+    
+    return true;
+}
+
+bool Database::setHabitDay(int habitId, const QDate& date, bool completed, bool& changed)
+{
+    changed = false;
+    HabitYearBitmap days;
+    if (!loadHabitYear(habitId, date.year(), days)) {
+        failOperation("Не удалось прочитать отметки привычки");
+        return false;
+    }
+    
+    if (!days.set(date.dayOfYear() - 1, completed)) {
+        return true;
+    }
+    
+    changed = true;
+    return storeHabitYear(habitId, date.year(), days);
+}
+
+bool Database::migrateTaskSchema()
+{
+    QMutexLocker writeLock(&writeMutex);
+    QSqlDatabase& db = connection();
+    QSqlQuery query(db);
+    
+    if (!query.exec("PRAGMA user_version") || !query.next()) {
+        qDebug() << "Ошибка чтения версии схемы:" << query.lastError().text();
+        return false;
+    }
+    int version = query.value(0).toInt();
+    
+    if (version < 2) {
+        if (!db.transaction()) {
+            qDebug() << "Ошибка начала миграции задач:" << db.lastError().text();
+            return false;
+        }
+        
+        QStringList columns;
+        bool ok = query.exec("PRAGMA table_info(tasks)");
+        while (ok && query.next()) {
+            columns << query.value(1).toString();
+        }
+        
+        // Новая база уже создана с целочисленными столбцами, перестраивать нечего.
+        QSqlQuery update(db);
+        if (ok && !columns.contains("task_day")) {
+            if (!columns.contains("recurrence_rule")) {
+                ok = query.exec("ALTER TABLE tasks ADD COLUMN recurrence_rule INTEGER");
+            }
+            
+            // Вариантов текста всего несколько, поэтому каждый переводится в код одним UPDATE.
+            if (version < 1 && columns.contains("recurrence")) {
+                ok = ok && update.prepare("UPDATE tasks SET recurrence_rule = ? WHERE recurrence = ?");
+                for (const RecurrencePreset& preset : recurrencePresets) {
+                    update.addBindValue(qint64(preset.rule.code()));
+                    update.addBindValue(QString::fromUtf8(preset.text));
+                    ok = ok && update.exec();
+                }
+            }
+            
+            // SQLite не умеет менять тип столбца, поэтому таблицы пересобираются:
+            // дата становится юлианским днём, время — минутой суток, срок доставки — их суммой.
+            ok = ok && query.exec("CREATE TABLE tasks_new ("
+                                  "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+                                  "user_id INTEGER NOT NULL,"
+                                  "title TEXT NOT NULL,"
+                                  "task_day INTEGER NOT NULL,"
+                                  "task_minute INTEGER,"
+                                  "is_time_bound INTEGER NOT NULL DEFAULT 1,"
+                                  "recurrence_rule INTEGER,"
+                                  "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,"
+                                  "FOREIGN KEY(user_id) REFERENCES users(id) ON DELETE CASCADE"
+                                  ")");
+            ok = ok && query.exec("INSERT INTO tasks_new (id, user_id, title, task_day, task_minute, "
+                                  "is_time_bound, recurrence_rule, created_at) "
+                                  "SELECT id, user_id, title, CAST(julianday(task_date) + 0.5 AS INTEGER), "
+                                  "CAST(substr(task_time, 1, 2) AS INTEGER) * 60 + CAST(substr(task_time, 4, 2) AS INTEGER), "
+                                  "is_time_bound, recurrence_rule, created_at FROM tasks");
+            ok = ok && query.exec("DROP TABLE tasks");
+            ok = ok && query.exec("ALTER TABLE tasks_new RENAME TO tasks");
+            
+            ok = ok && query.exec("CREATE TABLE reminder_deliveries_new ("
+                                  "task_id INTEGER NOT NULL,"
+                                  "due_at INTEGER NOT NULL,"
+                                  "delivered_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,"
+                                  "PRIMARY KEY(task_id, due_at),"
+                                  "FOREIGN KEY(task_id) REFERENCES tasks(id) ON DELETE CASCADE"
+                                  ") WITHOUT ROWID");
+            ok = ok && query.exec("INSERT OR IGNORE INTO reminder_deliveries_new (task_id, due_at, delivered_at) "
+                                  "SELECT task_id, CAST(julianday(substr(due_at, 1, 10)) + 0.5 AS INTEGER) * 1440 "
+                                  "+ CAST(substr(due_at, 12, 2) AS INTEGER) * 60 + CAST(substr(due_at, 15, 2) AS INTEGER), "
+                                  "delivered_at FROM reminder_deliveries WHERE typeof(due_at) = 'text'");
+            ok = ok && query.exec("DROP TABLE reminder_deliveries");
+            ok = ok && query.exec("ALTER TABLE reminder_deliveries_new RENAME TO reminder_deliveries");
+            ok = ok && query.exec("DROP INDEX IF EXISTS idx_tasks_user_date");
+        }
+        
+        ok = ok && query.exec("PRAGMA user_version = 2");
+        
+        if (!ok) {
+            qDebug() << "Ошибка миграции таблицы задач:" << query.lastError().text() << update.lastError().text();
+            db.rollback();
+            return false;
+        }
+        
+        if (!db.commit()) {
+            qDebug() << "Ошибка завершения миграции задач:" << db.lastError().text();
+            return false;
+        }
+    }
+    
+    // Индекс покрывающий: выборки периода и напоминаний читают только его, не обращаясь к строкам таблицы.
+    if (version < 3) {
+        if (!query.exec("DROP INDEX IF EXISTS idx_tasks_user_day") || !query.exec("PRAGMA user_version = 3")) {
+            qDebug() << "Ошибка перестройки индекса задач:" << query.lastError().text();
+            return false;
+        }
+    }
+    
+    if (!query.exec("CREATE INDEX IF NOT EXISTS idx_tasks_user_day ON tasks(user_id, task_day, "
+                    "task_minute, is_time_bound, recurrence_rule, title)")) {
+        qDebug() << "Ошибка создания индекса задач:" << query.lastError().text();
+        return false;
+    }
+    
+    // Частичный индекс: повторяющиеся задачи пользователя читаются одним коротким проходом.
+    if (!query.exec("CREATE INDEX IF NOT EXISTS idx_tasks_recurring ON tasks(user_id, task_day) "
+                    "WHERE recurrence_rule IS NOT NULL")) {
+        qDebug() << "Ошибка создания индекса повторяющихся задач:" << query.lastError().text();
+        return false;
+    }
+    
+    return true;
+}
+
+bool Database::migrateHabitStorage()
+{
+    QMutexLocker writeLock(&writeMutex);
+    QSqlDatabase& db = connection();
+    if (!db.transaction()) {
+        qDebug() << "Ошибка начала миграции отметок привычек:" << db.lastError().text();
+        return false;
+    }
+    
+    QSqlQuery query(db);
+    bool ok = true;
+    
+    if (habitStorage == HabitStorage::Bitmap) {
+        QHash<QPair<int, int>, HabitYearBitmap> years;
+        ok = query.exec("SELECT habit_id, completion_date FROM habit_completions");
+        while (ok && query.next()) {
+            int habitId = query.value(0).toInt();
+            QDate date = query.value(1).toDate();
+            QPair<int, int> key(habitId, date.year());
+            if (!years.contains(key)) {
+                HabitYearBitmap days;
+                ok = loadHabitYear(habitId, date.year(), days);
+                years.insert(key, days);
+            }
+            years[key].set(date.dayOfYear() - 1, true);
+        }
+        
+        for (auto it = years.constBegin(); ok && it != years.constEnd(); ++it) {
+            ok = storeHabitYear(it.key().first, it.key().second, it.value());
+        }
+        
+        if (ok) {
+            ok = query.exec("DELETE FROM habit_completions");
+        }
+    } else {
+        QSqlQuery insert(db);
+        ok = query.exec("SELECT habit_id, year, days FROM habit_completion_years")
+             && insert.prepare("INSERT OR IGNORE INTO habit_completions (habit_id, completion_date) VALUES (?, ?)");
+        while (ok && query.next()) {
+            int habitId = query.value(0).toInt();
+            QDate firstDay(query.value(1).toInt(), 1, 1);
+            HabitYearBitmap days = HabitYearBitmap::fromBlob(query.value(2).toByteArray());
+            days.forEachSetDay(0, firstDay.daysInYear(), [&](int day) {
+                insert.addBindValue(habitId);
+                insert.addBindValue(firstDay.addDays(day));
+                ok = ok && insert.exec();
+            });
+        }
+        
+        if (ok) {
+            ok = query.exec("DELETE FROM habit_completion_years");
+        }
+    }
+    
+    if (!ok) {
+        qDebug() << "Ошибка миграции отметок привычек:" << query.lastError().text();
+        db.rollback();
+        return false;
+    }
+    
+    return db.commit();
+}
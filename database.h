@@ -5,14 +5,102 @@
 #include <QSqlQuery>
 #include <QString>
 #include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <QPair>
+#include <QList>
+#include <QThread>
+#include <QThreadStorage>
+#include <QMutex>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <functional>
+#include "records.h"
+#include "habitstreak.h"
+#include "habitbitmap.h"
+#include "storageprofile.h"
+#include "recurrence.h"
 
 class Database
 {
 public:
+    
+    enum class HabitStorage {
+        Rows,
+        Bitmap
+    };
+    
+    struct BatchFailure {
+        int operation;
+        QString error;
+    };
+    
+    struct BatchResult {
+        bool committed = false;
+        int operationCount = 0;
+        std::vector<BatchFailure> failures;
+    };
+    
+    // Запросы, подготовленные в кэше соединения. Текст доступен снаружи для диагностики,
+    // например чтобы проверить план выборки через EXPLAIN QUERY PLAN.
+    enum class StatementId {
+        InsertUser,
+        SelectUserByName,
+        InsertTask,
+        UpdateTask,
+        DeleteTask,
+        SelectTaskSchedule,
+        TasksForDay,
+        TasksForWeek,
+        TasksForRange,
+        DeleteOldTasks,
+        RecurringTasks,
+        PendingReminders,
+        DeliveredOccurrences,
+        InsertReminderDelivery,
+        DeleteTaskDeliveries,
+        DeleteOldDeliveries,
+        InsertNote,
+        UpdateNote,
+        DeleteNote,
+        SelectNotes,
+        SelectNote,
+        InsertHabit,
+        DeleteHabit,
+        SelectHabits,
+        MarkHabitCompleted,
+        UnmarkHabitCompleted,
+        IsHabitCompleted,
+        HabitCompletionsInRange,
+        HabitCompletionCount,
+        SelectHabitYear,
+        SelectHabitYearsInRange,
+        SelectHabitYearsDesc,
+        UpsertHabitYear,
+        DeleteHabitYear,
+        DeleteHabitYears,
+        LatestHabitRun,
+        SelectHabitStreak,
+        UpsertHabitStreak,
+        DeleteHabitStreak
+    };
+    
+    static QString statementSql(StatementId id);
 
     static Database& instance();
 
-    bool initialize();
+    // Пустой путь — tasks.db в каталоге данных приложения.
+    bool initialize(const QString& path = QString());
+    
+    // Соединение текущего потока. Поток, вызвавший initialize(), работает через основное
+    // соединение; любой другой поток при первом обращении получает своё именованное
+    // соединение к тому же файлу, которое закрывается при завершении потока.
+    QSqlDatabase& connection();
+    
+    void releaseThreadConnection();
+    
+    int pooledConnectionCount() const { return pooledConnections; }
 
     bool createTables();
     
@@ -29,18 +117,44 @@ public:
     bool isLoggedIn() const { return currentUserId > 0; }
     
     bool createTask(int userId, const QString& title, const QDateTime& dateTime, 
-                    bool isTimeBound, const QString& recurrence = QString());
+                    bool isTimeBound, const RecurrenceRule& recurrence = RecurrenceRule());
     
     bool updateTask(int taskId, const QString& title, const QDateTime& dateTime,
-                    bool isTimeBound, const QString& recurrence = QString());
+                    bool isTimeBound, const RecurrenceRule& recurrence = RecurrenceRule());
     
     bool deleteTask(int taskId);
     
-    QList<QHash<QString, QVariant>> getTasksForDay(int userId, const QDate& date);
+    // Пакетная запись: операции между beginBatch() и commitBatch() в текущем потоке идут одной
+    // транзакцией и откатываются целиком, если хотя бы одна из них не удалась.
+    bool beginBatch();
+    
+    BatchResult commitBatch();
+    
+    void rollbackBatch();
+    
+    BatchResult createTasks(int userId, const std::vector<TaskRecord>& tasks);
+    
+    std::vector<TaskRecord> getTasksForDay(int userId, const QDate& date);
+    
+    std::vector<TaskRecord> getTasksForWeek(int userId, const QDate& weekStart);
+    
+    // При ошибке выборки возвращает пустой результат и *ok = false: отличить его от периода
+    // без задач можно только по ok.
+    QHash<QDate, std::vector<TaskRecord>> getTasksForRange(int userId, const QDate& from, const QDate& to,
+                                                           bool *ok = nullptr);
     
-    QList<QHash<QString, QVariant>> getTasksForWeek(int userId, const QDate& weekStart);
+    // Разовые задачи старше RetentionDays дней до начала текущей недели удаляются.
+    // Возвращает число удалённых задач.
+    static constexpr int RetentionDays = 21;
     
-    void cleanupOldData(int userId, const QDate& currentWeekStart);
+    int cleanupOldData(int userId, const QDate& currentWeekStart);
+    
+    // Задачи с привязкой ко времени, срок которых попадает в [from, to) и напоминание о которых
+    // ещё не доставлено. Повторяющаяся задача даёт запись на каждое повторение в этом окне.
+    std::vector<TaskRecord> getPendingReminders(int userId, const QDateTime& from, const QDateTime& to);
+    
+    // dueAt — срок конкретного повторения: у серии доставка отмечается для каждого отдельно.
+    bool recordReminderDelivery(int taskId, const QDateTime& dueAt);
     
     int createNote(int userId, const QString& name, const QString& content = QString());
     
@@ -48,33 +162,116 @@ public:
     
     bool deleteNote(int noteId);
     
-    QList<QHash<QString, QVariant>> getNotes(int userId);
+    std::vector<NoteRecord> getNotes(int userId);
     
-    QHash<QString, QVariant> getNote(int noteId);
+    NoteRecord getNote(int noteId);
     
     int createHabit(int userId, const QString& name);
     
     bool deleteHabit(int habitId);
     
-    QList<QHash<QString, QVariant>> getHabits(int userId);
+    std::vector<HabitRecord> getHabits(int userId);
     
+    // true — день теперь отмечен (или уже был отмечен), false — ошибка записи.
+    // Уведомление уходит, только если отметка действительно изменилась.
     bool markHabitCompleted(int habitId, const QDate& date);
     
+    // true — отметки за день теперь нет, false — ошибка записи.
     bool unmarkHabitCompleted(int habitId, const QDate& date);
     
     bool isHabitCompleted(int habitId, const QDate& date);
 
+    QList<QDate> getHabitCompletions(int habitId, const QDate& from, const QDate& to);
+    
     QList<QDate> getHabitCompletionsForMonth(int habitId, int year, int month);
     
+    int getHabitCompletionCount(int habitId, const QDate& from, const QDate& to);
+    
+    HabitStorage habitStorageMode() const { return habitStorage; }
+    
+    const StorageProfile& storageProfile() const { return profile; }
+    
+    int getCurrentStreak(int habitId);
+    
+    // Последняя серия целиком, чтобы представление могло обновлять её само при переключении дня.
+    HabitStreak getHabitStreak(int habitId);
+    
+    quint64 statementCacheHits() const { return cacheHits; }
+    
+    quint64 statementCacheMisses() const { return cacheMisses; }
+    
 private:
     Database();
     ~Database();
     Database(const Database&) = delete;
     Database& operator=(const Database&) = delete;
     
-    QSqlDatabase db;
+    static constexpr qint64 MinutesPerDay = 24 * 60;
+    
+    struct CachedStatement {
+        QSqlQuery query;
+        bool prepared = false;
+    };
+    
+    struct Connection {
+        QSqlDatabase db;
+        std::unordered_map<int, CachedStatement> statements;
+        bool inBatch = false;
+        BatchResult batch;
+        // Уведомления об изменениях внутри пакета ждут его фиксации. Задачи сводятся по дням,
+        // а все изменения серий пользователя — в одно, начиная с самой ранней даты.
+        std::vector<std::function<void()>> pendingNotifications;
+        QSet<QPair<int, QDate>> pendingTaskDays;
+        QHash<int, QDate> pendingSeriesStarts;
+    };
+    
+    struct PooledConnection : Connection {
+        // Поколение initialize(), при котором соединение открыто.
+        int generation = 0;
+        ~PooledConnection();
+    };
+    
+    Connection mainConnection;
+    QThread *ownerThread;
+    QThreadStorage<PooledConnection*> threadConnections;
+    std::atomic<int> pooledConnections;
+    std::atomic<int> nextConnectionId;
+    std::atomic<int> connectionGeneration;
+    // Читатели в режиме WAL работают параллельно, запись идёт строго по одной.
+    QRecursiveMutex writeMutex;
+    QString databasePath;
     int currentUserId;
+    HabitStorage habitStorage;
+    StorageProfile profile;
+    std::atomic<quint64> cacheHits;
+    std::atomic<quint64> cacheMisses;
     QString hashPassword(const QString& password);
+    Connection& currentConnection();
+    PooledConnection* openPooledConnection();
+    bool configureConnection(QSqlDatabase& db);
+    QSqlQuery& cachedQuery(StatementId id);
+    bool execWrite(QSqlQuery& query, bool startsOperation = true);
+    void failOperation(const QString& error, bool startsOperation = true);
+    void notify(std::function<void()> notification);
+    void notifyTasksChanged(int userId, const QDate& date, bool recurring);
+    static void clearPendingNotifications(Connection& connection);
+    bool readTaskSchedule(int taskId, int& userId, QDate& date, bool& recurring);
+    std::vector<TaskRecord> getRecurringOccurrences(int userId, const QDate& from, const QDate& to,
+                                                    bool *ok = nullptr);
+    static void sortTasks(std::vector<TaskRecord>& tasks);
+    static qint64 minuteStamp(const QDateTime& dateTime);
+    static qint64 dueStamp(const QDate& date, const QTime& time);
+    bool computeHabitStreak(int habitId, HabitStreak& streak);
+    bool loadHabitStreak(int habitId, HabitStreak& streak);
+    bool storeHabitStreak(int habitId, const HabitStreak& streak);
+    bool updateHabitStreak(int habitId, const QDate& date, bool completed);
+    bool migrateTaskSchema();
+    bool migrateHabitStorage();
+    bool loadHabitYear(int habitId, int year, HabitYearBitmap& days);
+    bool storeHabitYear(int habitId, int year, const HabitYearBitmap& days);
+    // false — ошибка чтения или записи; changed сообщает, поменялась ли отметка.
+    bool setHabitDay(int habitId, const QDate& date, bool completed, bool& changed);
+    bool computeHabitStreakFromBitmaps(int habitId, HabitStreak& streak);
 };
 
 #endif
@@ -0,0 +1,7 @@
+#include "databasenotifier.h"
+
+DatabaseNotifier& DatabaseNotifier::instance()
+{
+    static DatabaseNotifier instance;
+    return instance;
+}
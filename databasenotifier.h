@@ -0,0 +1,33 @@
+#ifndef DATABASENOTIFIER_H
+#define DATABASENOTIFIER_H
+
+#include <QObject>
+#include <QDate>
+
+// Сигналы об изменениях, записанных через Database. Они отправляются после фиксации записи
+// (для пакетной записи — после commitBatch, по одному сигналу на день или серию) из того потока,
+// который писал; получатели в потоке интерфейса получают их через очередь событий.
+class DatabaseNotifier : public QObject
+{
+    Q_OBJECT
+
+public:
+    static DatabaseNotifier& instance();
+
+signals:
+    // Изменились разовые задачи одного дня.
+    void tasksChanged(int userId, const QDate& date);
+    
+    // Изменилась повторяющаяся серия: затронуты все дни начиная с from.
+    void taskSeriesChanged(int userId, const QDate& from);
+    
+    // Заметка создана, изменена или удалена.
+    void noteChanged(int noteId);
+    
+    void habitCompletionChanged(int habitId, const QDate& date, bool completed);
+
+private:
+    DatabaseNotifier() = default;
+};
+
+#endif
@@ -0,0 +1,38 @@
+#include "databaseworker.h"
+
+DatabaseWorker& DatabaseWorker::instance()
+{
+    static DatabaseWorker instance;
+    return instance;
+}
+
+DatabaseWorker::DatabaseWorker() : context(new QObject)
+{
+    thread.setObjectName("DatabaseWorker");
+    context->moveToThread(&thread);
+    
+    QObject::connect(&thread, &QThread::finished, context, []() {
+        Database::instance().releaseThreadConnection();
+    }, Qt::DirectConnection);
+}
+
+DatabaseWorker::~DatabaseWorker()
+{
+    stop();
+    delete context;
+}
+
+void DatabaseWorker::start()
+{
+    if (!thread.isRunning()) {
+        thread.start();
+    }
+}
+
+void DatabaseWorker::stop()
+{
+    if (thread.isRunning()) {
+        thread.quit();
+        thread.wait();
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef DATABASEWORKER_H
+#define DATABASEWORKER_H
+
+#include <QObject>
+#include <QThread>
+#include <QFuture>
+#include <QPromise>
+#include <memory>
+#include <type_traits>
+#include "database.h"
+
+// Поток базы данных со своим соединением из пула Database: задания выполняются по очереди,
+// результат возвращается через QFuture (продолжения .then(context, ...) приходят в поток контекста).
+class DatabaseWorker
+{
+public:
+    static DatabaseWorker& instance();
+
+    void start();
+
+    void stop();
+
+    template <typename Function>
+    QFuture<std::invoke_result_t<Function, Database&>> run(Function function)
+    {
+        using Result = std::invoke_result_t<Function, Database&>;
+        
+        auto promise = std::make_shared<QPromise<Result>>();
+        QFuture<Result> future = promise->future();
+        promise->start();
+        
+        QMetaObject::invokeMethod(context, [promise, function]() mutable {
+            if constexpr (std::is_void_v<Result>) {
+                function(Database::instance());
+            } else {
+                promise->addResult(function(Database::instance()));
+            }
+            promise->finish();
+        }, Qt::QueuedConnection);
+        
+        return future;
+    }
+
+private:
+    DatabaseWorker();
+    ~DatabaseWorker();
+    DatabaseWorker(const DatabaseWorker&) = delete;
+    DatabaseWorker& operator=(const DatabaseWorker&) = delete;
+    
+    QThread thread;
+    QObject *context;
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include "dayview.h"
 #include "taskdialog.h"
 #include "database.h"
+#include "taskrepository.h"
 #include <QMessageBox>
 #include <QLocale>
 #include <QHBoxLayout>
@@ -20,8 +21,18 @@ static QString getMonthNameNominative(int month)
     return QString();
 }
 
-DayView::DayView(QWidget *parent)
-    : QWidget(parent)
+// Повторение редактируется и переносится всей серией, поэтому в диалог идут дата и время
+// исходной задачи, а не выбранного дня.
+static void useSeriesStart(TaskRecord& task)
+{
+    if (task.seriesDate.isValid()) {
+        task.date = task.seriesDate;
+        task.time = task.seriesTime;
+    }
+}
+
+DayView::DayView(TaskModel *model, QWidget *parent)
+    : QWidget(parent), taskModel(model)
 {
     QVBoxLayout *layout = new QVBoxLayout(this);
     
@@ -29,8 +40,12 @@ DayView::DayView(QWidget *parent)
     backButton = new QPushButton("<- Назад");
     dateLabel = new QLabel;
     dateLabel->setStyleSheet("font-size: 18px; font-weight: bold;");
+    loadingLabel = new QLabel("Загрузка...");
+    loadingLabel->setStyleSheet("font-size: 10px; color: #888;");
+    loadingLabel->hide();
     headerLayout->addWidget(backButton);
     headerLayout->addWidget(dateLabel);
+    headerLayout->addWidget(loadingLabel);
     headerLayout->addStretch();
     
     layout->addLayout(headerLayout);
@@ -55,6 +70,9 @@ DayView::DayView(QWidget *parent)
     connect(moveButton, &QPushButton::clicked, this, &DayView::onMoveTaskClicked);
 
     connect(taskList, &QListWidget::itemDoubleClicked, this, &DayView::onTaskDoubleClicked);
+    
+    connect(taskModel, &QAbstractItemModel::modelReset, this, &DayView::onModelReset);
+    connect(taskModel, &TaskModel::dayChanged, this, &DayView::onDayChanged);
 }
 
 void DayView::setDate(const QDate& date)
@@ -77,29 +95,46 @@ void DayView::setDate(const QDate& date)
 
 void DayView::refreshTasks()
 {
-    taskList->clear();
-    
-    Database& db = Database::instance();
-    if (!db.isLoggedIn()) {
+    loadingLabel->setVisible(Database::instance().isLoggedIn());
+    taskModel->setRange(currentDate, currentDate);
+}
+
+void DayView::onModelReset()
+{
+    if (!taskModel->hasRange(currentDate, currentDate)) {
         return;
     }
     
-    auto tasks = db.getTasksForDay(db.getCurrentUserId(), currentDate);
+    showTasks();
+    loadingLabel->hide();
+}
+
+void DayView::onDayChanged(const QDate& date)
+{
+    if (date == currentDate) {
+        showTasks();
+    }
+}
+
+void DayView::showTasks()
+{
+    taskList->clear();
     
-    for (const auto& task : tasks) {
-        QString title = task["title"].toString();
-        bool isTimeBound = task["is_time_bound"].toBool();
+    QModelIndex day = taskModel->dayIndex(currentDate);
+    int taskCount = day.isValid() ? taskModel->rowCount(day) : 0;
+    
+    for (int i = 0; i < taskCount; ++i) {
+        QModelIndex task = taskModel->index(i, 0, day);
         QString timeStr;
         
-        if (isTimeBound && !task["task_time"].isNull()) {
-            QTime time = task["task_time"].toTime();
-            timeStr = time.toString("HH:mm");
+        if (task.data(TaskModel::TimeBoundRole).toBool()) {
+            timeStr = task.data(TaskModel::TimeRole).toTime().toString("HH:mm");
         }
         
-        QString recurrence = task["recurrence"].toString();
-        QString recurrenceStr = formatRecurrence(recurrence);
+        QString recurrenceStr = formatRecurrence(
+            RecurrenceRule::fromCode(task.data(TaskModel::RecurrenceRole).toULongLong()));
         
-        QString displayText = title;
+        QString displayText = task.data(TaskModel::TitleRole).toString();
         
         if (!timeStr.isEmpty()) {
             displayText = timeStr + " - " + displayText;
@@ -110,7 +145,7 @@ void DayView::refreshTasks()
         }
         
         QListWidgetItem *item = new QListWidgetItem(displayText);
-        item->setData(Qt::UserRole, task["id"]);
+        item->setData(Qt::UserRole, task.data(TaskModel::TaskIdRole));
         taskList->addItem(item);
     }
 }
@@ -124,15 +159,12 @@ void DayView::onAddTaskClicked()
     
     TaskDialog dialog(currentDate, this);
     if (dialog.exec() == QDialog::Accepted) {
-        Database& db = Database::instance();
-        if (db.createTask(db.getCurrentUserId(), dialog.getTitle(), 
-                         dialog.getDateTime(), dialog.isTimeBound(), 
-                         dialog.getRecurrence())) {
-            refreshTasks();
-            emit taskAdded(currentDate);
-        } else {
-            QMessageBox::warning(this, "Ошибка", "Не удалось создать задачу");
-        }
+        TaskRepository::instance().createTask(dialog.getTitle(), dialog.getDateTime(),
+                                              dialog.isTimeBound(), dialog.getRecurrence()).then(this, [this](bool created) {
+            if (!created) {
+                QMessageBox::warning(this, "Ошибка", "Не удалось создать задачу");
+            }
+        });
     }
 }
 
@@ -140,43 +172,41 @@ void DayView::onTaskDoubleClicked(QListWidgetItem* item)
 {
     int taskId = item->data(Qt::UserRole).toInt();
     
-    Database& db = Database::instance();
-    auto tasks = db.getTasksForDay(db.getCurrentUserId(), currentDate);
+    TaskRecord task;
+    if (!findTask(taskId, task)) {
+        return;
+    }
+    
+    useSeriesStart(task);
     
-    for (const auto& task : tasks) {
-        if (task["id"].toInt() == taskId) {
-            QDateTime dateTime;
-            if (task["is_time_bound"].toBool()) {
-                dateTime = QDateTime(task["task_date"].toDate(), 
-                                    task["task_time"].toTime());
-            } else {
-                dateTime = QDateTime(task["task_date"].toDate(), QTime());
-            }
-            
-            TaskDialog dialog(taskId, task["title"].toString(), dateTime,
-                            task["is_time_bound"].toBool(), 
-                            task["recurrence"].toString(), this);
-            
-            if (dialog.exec() == QDialog::Accepted) {
-                if (db.updateTask(taskId, dialog.getTitle(), dialog.getDateTime(),
-                                dialog.isTimeBound(), dialog.getRecurrence())) {
-                    refreshTasks();
-                    emit taskAdded(currentDate);
-                } else {
-                    QMessageBox::warning(this, "Ошибка", "Не удалось обновить задачу");
-                }
+    QDateTime dateTime;
+    if (task.isTimeBound) {
+        dateTime = QDateTime(task.date, task.time);
+    } else {
+        dateTime = QDateTime(task.date, QTime());
+    }
+    
+    TaskDialog dialog(taskId, task.title, dateTime,
+                    task.isTimeBound, task.recurrence, this);
+    
+    if (dialog.exec() == QDialog::Accepted) {
+        TaskRepository::instance().updateTask(taskId, dialog.getTitle(), dialog.getDateTime(),
+                                              dialog.isTimeBound(), dialog.getRecurrence()).then(this, [this](bool updated) {
+            if (!updated) {
+                QMessageBox::warning(this, "Ошибка", "Не удалось обновить задачу");
             }
-            break;
-        }
+        });
     }
 }
 
-QString DayView::formatRecurrence(const QString& recurrence) const
+bool DayView::findTask(int taskId, TaskRecord& task) const
 {
-    if (recurrence.isEmpty()) {
-        return QString();
-    }
-    return recurrence;
+    return taskModel->findTask(taskId, task);
+}
+
+QString DayView::formatRecurrence(const RecurrenceRule& recurrence) const
+{
+    return recurrence.displayText();
 }
 
 void DayView::onDeleteTaskClicked()
@@ -196,15 +226,13 @@ void DayView::onDeleteTaskClicked()
     
     int taskId = selectedItem->data(Qt::UserRole).toInt();
     
-    Database& db = Database::instance();
-    
-    if (db.deleteTask(taskId)) {
-        refreshTasks();
-        emit taskAdded(currentDate);
-        QMessageBox::information(this, "Успех", "Задача удалена");
-    } else {
-        QMessageBox::warning(this, "Ошибка", "Не удалось удалить задачу");
-    }
+    TaskRepository::instance().deleteTask(taskId).then(this, [this](bool deleted) {
+        if (deleted) {
+            QMessageBox::information(this, "Успех", "Задача удалена");
+        } else {
+            QMessageBox::warning(this, "Ошибка", "Не удалось удалить задачу");
+        }
+    });
 }
 
 void DayView::onMoveTaskClicked()
@@ -217,54 +245,34 @@ void DayView::onMoveTaskClicked()
     
     int taskId = selectedItem->data(Qt::UserRole).toInt();
     
-    Database& db = Database::instance();
-    auto tasks = db.getTasksForDay(db.getCurrentUserId(), currentDate);
-    
-    QHash<QString, QVariant> task;
-    bool found = false;
-    for (const auto& t : tasks) {
-        if (t["id"].toInt() == taskId) {
-            task = t;
-            found = true;
-            break;
-        }
-    }
-    
-    if (!found) {
+    TaskRecord task;
+    if (!findTask(taskId, task)) {
         QMessageBox::warning(this, "Ошибка", "Задача не найдена");
         return;
     }
+    useSeriesStart(task);
     
-    QString title = task["title"].toString();
-    bool isTimeBound = task["is_time_bound"].toBool();
-    QString recurrence = task["recurrence"].toString();
+    QString title = task.title;
+    bool isTimeBound = task.isTimeBound;
+    RecurrenceRule recurrence = task.recurrence;
     
     QDateTime dateTime;
-    if (isTimeBound && !task["task_time"].isNull()) {
-        dateTime = QDateTime(task["task_date"].toDate(), task["task_time"].toTime());
+    if (isTimeBound && task.time.isValid()) {
+        dateTime = QDateTime(task.date, task.time);
     } else {
-        dateTime = QDateTime(task["task_date"].toDate(), QTime(9, 0));
+        dateTime = QDateTime(task.date, QTime(9, 0));
     }
     
     TaskDialog dialog(taskId, title, dateTime, isTimeBound, recurrence, this);
     
     if (dialog.exec() == QDialog::Accepted) {
-
-        QString newTitle = dialog.getTitle();
-        QDateTime newDateTime = dialog.getDateTime();
-        bool newIsTimeBound = dialog.isTimeBound();
-        QString newRecurrence = dialog.getRecurrence();
-        
-        int userId = db.getCurrentUserId();
-        if (db.createTask(userId, newTitle, newDateTime, newIsTimeBound, newRecurrence)) {
-
-            db.deleteTask(taskId);
-            
-            refreshTasks();
-            emit taskAdded(currentDate);
-            QMessageBox::information(this, "Успех", "Задача перенесена");
-        } else {
-            QMessageBox::warning(this, "Ошибка", "Не удалось перенести задачу");
-        }
+        TaskRepository::instance().moveTask(taskId, dialog.getTitle(), dialog.getDateTime(),
+                                            dialog.isTimeBound(), dialog.getRecurrence()).then(this, [this](bool moved) {
+            if (moved) {
+                QMessageBox::information(this, "Успех", "Задача перенесена");
+            } else {
+                QMessageBox::warning(this, "Ошибка", "Не удалось перенести задачу");
+            }
+        });
     }
 }
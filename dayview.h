@@ -7,13 +7,14 @@
 #include <QPushButton>
 #include <QLabel>
 #include <QDate>
+#include "taskmodel.h"
 
 class DayView : public QWidget
 {
     Q_OBJECT
 
 public:
-    explicit DayView(QWidget *parent = nullptr);
+    explicit DayView(TaskModel *model, QWidget *parent = nullptr);
 
     void setDate(const QDate& date);
     
@@ -21,24 +22,29 @@ public:
 
 signals:
     void backRequested();
-    void taskAdded(const QDate& date);
 
 public slots:
     void onAddTaskClicked();
 
 private slots:
     void onTaskDoubleClicked(QListWidgetItem* item);
+    void onModelReset();
+    void onDayChanged(const QDate& date);
     void onDeleteTaskClicked();
     void onMoveTaskClicked();
 
 private:
+    TaskModel *taskModel;
     QDate currentDate;
     QLabel *dateLabel;
     QListWidget *taskList;
     QPushButton *addButton;
     QPushButton *backButton;
+    QLabel *loadingLabel;
     
-    QString formatRecurrence(const QString& recurrence) const;
+    QString formatRecurrence(const RecurrenceRule& recurrence) const;
+    void showTasks();
+    bool findTask(int taskId, TaskRecord& task) const;
 };
 
 #endif
@@ -0,0 +1,126 @@
+#ifndef HABITBITMAP_H
+#define HABITBITMAP_H
+
+#include <QByteArray>
+#include <QtAlgorithms>
+#include <QtGlobal>
+
+// Отметки привычки за один год: бит N соответствует дню года N + 1.
+class HabitYearBitmap
+{
+public:
+    static constexpr int DayCount = 366;
+    static constexpr int ByteCount = (DayCount + 7) / 8;
+
+    bool test(int day) const
+    {
+        return (words[day / 64] >> (day % 64)) & 1u;
+    }
+
+    bool set(int day, bool value)
+    {
+        quint64 bit = quint64(1) << (day % 64);
+        quint64& word = words[day / 64];
+        quint64 updated = value ? (word | bit) : (word & ~bit);
+        bool changed = updated != word;
+        word = updated;
+        return changed;
+    }
+
+    bool isEmpty() const
+    {
+        for (quint64 word : words) {
+            if (word) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int count(int fromDay, int toDay) const
+    {
+        int total = 0;
+        for (int w = 0; w < WordCount; ++w) {
+            total += qPopulationCount(words[w] & rangeMask(w, fromDay, toDay));
+        }
+        return total;
+    }
+
+    int lastSetDay() const
+    {
+        for (int w = WordCount - 1; w >= 0; --w) {
+            if (words[w]) {
+                return w * 64 + 63 - int(qCountLeadingZeroBits(words[w]));
+            }
+        }
+        return -1;
+    }
+
+    // Длина непрерывной серии отметок, заканчивающейся днём day включительно.
+    int runEndingAt(int day) const
+    {
+        int run = 0;
+        for (int w = day / 64; w >= 0; --w) {
+            int top = (w == day / 64) ? day % 64 : 63;
+            quint64 aligned = words[w] << (63 - top);
+            int ones = int(qCountLeadingZeroBits(~aligned));
+            if (ones > top + 1) {
+                ones = top + 1;
+            }
+            run += ones;
+            if (ones != top + 1) {
+                break;
+            }
+        }
+        return run;
+    }
+
+    template <typename Callback>
+    void forEachSetDay(int fromDay, int toDay, Callback callback) const
+    {
+        for (int w = 0; w < WordCount; ++w) {
+            quint64 bits = words[w] & rangeMask(w, fromDay, toDay);
+            while (bits) {
+                callback(w * 64 + int(qCountTrailingZeroBits(bits)));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    QByteArray toBlob() const
+    {
+        QByteArray blob(ByteCount, '\0');
+        for (int i = 0; i < ByteCount; ++i) {
+            blob[i] = char((words[i / 8] >> ((i % 8) * 8)) & 0xFF);
+        }
+        return blob;
+    }
+
+    static HabitYearBitmap fromBlob(const QByteArray& blob)
+    {
+        HabitYearBitmap bitmap;
+        int size = qMin(int(blob.size()), int(ByteCount));
+        for (int i = 0; i < size; ++i) {
+            bitmap.words[i / 8] |= quint64(quint8(blob[i])) << ((i % 8) * 8);
+        }
+        return bitmap;
+    }
+
+private:
+    static constexpr int WordCount = (DayCount + 63) / 64;
+
+    static quint64 rangeMask(int word, int fromDay, int toDay)
+    {
+        int low = qMax(fromDay - word * 64, 0);
+        int high = qMin(toDay - word * 64, 64);
+        if (low >= high) {
+            return 0;
+        }
+        quint64 mask = (high - low == 64) ? ~quint64(0) : ((quint64(1) << (high - low)) - 1);
+        return mask << low;
+    }
+
+    quint64 words[WordCount] = {};
+};
+
+#endif
@@ -0,0 +1,388 @@
+#include "habitgrid.h"
+#include "paintutils.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QMouseEvent>
+#include <QKeyEvent>
+#include <QScrollBar>
+
+static const QColor RowBackground("#f9f9f9");
+static const QColor RowBorder("#ddd");
+static const QColor CellBorder("#ccc");
+static const QColor FutureBackground("#f0f0f0");
+static const QColor FutureText("#999");
+static const QColor CompletedBackground("#90EE90");
+static const QColor NameText("#333");
+
+HabitGrid::HabitGrid(QWidget *parent)
+    : QAbstractScrollArea(parent),
+      model(nullptr),
+      daysInMonth(0),
+      lastOpenDay(0),
+      focusRow(0),
+      focusDay(1),
+      nameFont(pixelFont(font(), 14, true)),
+      dayFont(pixelFont(font(), 10, false)),
+      completedDayFont(pixelFont(font(), 10, true)),
+      nameMetrics(nameFont)
+{
+    setFocusPolicy(Qt::StrongFocus);
+    viewport()->setBackgroundRole(QPalette::Window);
+}
+
+void HabitGrid::setModel(HabitModel *model)
+{
+    this->model = model;
+    connect(model, &QAbstractItemModel::modelReset, this, &HabitGrid::onModelReset);
+    connect(model, &QAbstractItemModel::dataChanged, this, &HabitGrid::onDataChanged);
+    onModelReset();
+}
+
+void HabitGrid::setMonth(const QDate& firstDay, const QDate& today)
+{
+    this->firstDay = firstDay;
+    this->today = today;
+    daysInMonth = firstDay.daysInMonth();
+    
+    if (today < firstDay) {
+        lastOpenDay = 0;
+    } else if (today >= firstDay.addMonths(1)) {
+        lastOpenDay = daysInMonth;
+    } else {
+        lastOpenDay = today.day();
+    }
+    
+    focusDay = qBound(1, lastOpenDay, daysInMonth);
+    updateScrollBars();
+    viewport()->update();
+}
+
+bool HabitGrid::isCompleted(int habitId, const QDate& date) const
+{
+    int row = model ? model->rowOf(habitId) : -1;
+    int day = dayOf(date);
+    if (row < 0 || day < 1) {
+        return false;
+    }
+    return model->completedDays(row) & (1u << (day - 1));
+}
+
+void HabitGrid::setCompleted(int habitId, const QDate& date, bool completed)
+{
+    int row = model ? model->rowOf(habitId) : -1;
+    int day = dayOf(date);
+    if (row >= 0 && day >= 1 && model->setCompleted(row, day, completed)) {
+        viewport()->update(cellRect(row, day));
+    }
+}
+
+// Рисуются только строки, попавшие в перерисовываемую часть окна.
+void HabitGrid::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(viewport());
+    const QRect& dirty = event->rect();
+    
+    int top = verticalScrollBar()->value() - Margin;
+    int first = qMax(0, (dirty.top() + top) / RowPitch);
+    int last = qMin(rowCount() - 1, (dirty.bottom() + top) / RowPitch);
+    
+    for (int row = first; row <= last; ++row) {
+        paintRow(painter, row, dirty);
+    }
+}
+
+// Пока отметки строки не загружены, рисуются пустые ячейки без серии.
+void HabitGrid::paintRow(QPainter& painter, int row, const QRect& dirty) const
+{
+    bool loaded = model->isLoaded(row);
+    quint32 completedDays = model->completedDays(row);
+    
+    QRect frame = rowRect(row);
+    painter.setPen(RowBorder);
+    painter.setBrush(RowBackground);
+    painter.drawRoundedRect(frame.adjusted(0, 0, -1, -1), 3, 3);
+    painter.setBrush(Qt::NoBrush);
+    
+    QRect name = nameRect(row);
+    if (name.intersects(dirty)) {
+        painter.setFont(nameFont);
+        painter.setPen(NameText);
+        painter.drawText(name, Qt::AlignLeft | Qt::AlignVCenter,
+                         nameMetrics.elidedText(model->name(row), Qt::ElideRight, name.width()));
+    }
+    
+    for (int day = 1; day <= daysInMonth; ++day) {
+        QRect cell = cellRect(row, day);
+        if (!cell.intersects(dirty)) {
+            continue;
+        }
+        
+        bool future = isFuture(day);
+        bool completed = completedDays & (1u << (day - 1));
+        
+        if (future) {
+            painter.fillRect(cell, FutureBackground);
+        } else if (completed) {
+            painter.fillRect(cell, CompletedBackground);
+        } else {
+            painter.fillRect(cell, Qt::white);
+        }
+        
+        painter.setPen(CellBorder);
+        painter.drawRect(cell.adjusted(0, 0, -1, -1));
+        
+        if (hasFocus() && row == focusRow && day == focusDay) {
+            QPen focusPen(palette().color(QPalette::Highlight));
+            focusPen.setWidth(2);
+            painter.setPen(focusPen);
+            painter.drawRect(cell.adjusted(1, 1, -1, -1));
+        }
+        
+        painter.setFont(completed && !future ? completedDayFont : dayFont);
+        painter.setPen(future || !loaded ? FutureText : Qt::black);
+        painter.drawText(cell, Qt::AlignCenter, QString::number(day));
+    }
+    
+    QRect streak = streakRect(row);
+    if (loaded && streak.intersects(dirty)) {
+        painter.setFont(nameFont);
+        painter.setPen(NameText);
+        painter.drawText(streak, Qt::AlignCenter, QString::number(model->streak(row).currentLength(today)));
+    }
+}
+
+void HabitGrid::mousePressEvent(QMouseEvent *event)
+{
+    int row = 0;
+    int day = 0;
+    if (event->button() == Qt::LeftButton && cellAt(event->position().toPoint(), row, day)) {
+        setFocusCell(row, day);
+        if (!isFuture(day) && model->isLoaded(row)) {
+            emit dayToggled(model->habitId(row), firstDay.addDays(day - 1));
+        }
+        return;
+    }
+    QAbstractScrollArea::mousePressEvent(event);
+}
+
+void HabitGrid::keyPressEvent(QKeyEvent *event)
+{
+    if (rowCount() == 0 || daysInMonth == 0) {
+        QAbstractScrollArea::keyPressEvent(event);
+        return;
+    }
+    
+    int pageRows = qMax(1, viewport()->height() / RowPitch);
+    
+    switch (event->key()) {
+    case Qt::Key_Left:
+        setFocusCell(focusRow, qMax(1, focusDay - 1));
+        break;
+    case Qt::Key_Right:
+        setFocusCell(focusRow, qMin(daysInMonth, focusDay + 1));
+        break;
+    case Qt::Key_Up:
+        setFocusCell(qMax(0, focusRow - 1), focusDay);
+        break;
+    case Qt::Key_Down:
+        setFocusCell(qMin(rowCount() - 1, focusRow + 1), focusDay);
+        break;
+    case Qt::Key_PageUp:
+        setFocusCell(qMax(0, focusRow - pageRows), focusDay);
+        break;
+    case Qt::Key_PageDown:
+        setFocusCell(qMin(rowCount() - 1, focusRow + pageRows), focusDay);
+        break;
+    case Qt::Key_Home:
+        setFocusCell(focusRow, 1);
+        break;
+    case Qt::Key_End:
+        setFocusCell(focusRow, qMax(1, lastOpenDay));
+        break;
+    case Qt::Key_Space:
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+        if (!isFuture(focusDay) && model->isLoaded(focusRow)) {
+            emit dayToggled(model->habitId(focusRow), firstDay.addDays(focusDay - 1));
+        }
+        break;
+    default:
+        QAbstractScrollArea::keyPressEvent(event);
+        return;
+    }
+    event->accept();
+}
+
+void HabitGrid::focusInEvent(QFocusEvent *event)
+{
+    QAbstractScrollArea::focusInEvent(event);
+    if (rowCount() > 0) {
+        viewport()->update(cellRect(focusRow, focusDay));
+    }
+}
+
+void HabitGrid::focusOutEvent(QFocusEvent *event)
+{
+    QAbstractScrollArea::focusOutEvent(event);
+    if (rowCount() > 0) {
+        viewport()->update(cellRect(focusRow, focusDay));
+    }
+}
+
+void HabitGrid::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+    fetchVisibleRows();
+}
+
+// Уже нарисованное сдвигается целиком, перерисовывается только открывшаяся полоса.
+void HabitGrid::scrollContentsBy(int dx, int dy)
+{
+    viewport()->scroll(dx, dy);
+    fetchVisibleRows();
+}
+
+void HabitGrid::onModelReset()
+{
+    focusRow = qBound(0, focusRow, qMax(0, rowCount() - 1));
+    updateScrollBars();
+    viewport()->update();
+    fetchVisibleRows();
+}
+
+void HabitGrid::onDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QList<int>& roles)
+{
+    // Отметку, поставленную через setCompleted, сетка уже перерисовала сама.
+    if (roles.size() == 1 && roles.first() == HabitModel::CompletedRole) {
+        return;
+    }
+    
+    if (roles.size() == 1 && roles.first() == HabitModel::StreakRole && topLeft.row() == bottomRight.row()) {
+        viewport()->update(streakRect(topLeft.row()));
+        return;
+    }
+    
+    QRect changed = rowRect(topLeft.row()).united(rowRect(bottomRight.row()));
+    viewport()->update(changed.intersected(viewport()->rect()));
+}
+
+int HabitGrid::contentWidth() const
+{
+    return 2 * Margin + 2 * RowPadding + NameWidth + StreakWidth
+           + (daysInMonth + 1) * CellSpacing + daysInMonth * CellSize;
+}
+
+int HabitGrid::contentHeight() const
+{
+    int rows = rowCount();
+    return 2 * Margin + rows * RowPitch - (rows > 0 ? RowSpacing : 0);
+}
+
+QRect HabitGrid::rowRect(int row) const
+{
+    return QRect(Margin - horizontalScrollBar()->value(),
+                 Margin + row * RowPitch - verticalScrollBar()->value(),
+                 contentWidth() - 2 * Margin, RowHeight);
+}
+
+QRect HabitGrid::nameRect(int row) const
+{
+    QRect frame = rowRect(row);
+    return QRect(frame.left() + RowPadding, frame.top() + RowPadding, NameWidth, CellSize);
+}
+
+QRect HabitGrid::cellRect(int row, int day) const
+{
+    QRect name = nameRect(row);
+    return QRect(name.right() + 1 + CellSpacing + (day - 1) * (CellSize + CellSpacing), name.top(),
+                 CellSize, CellSize);
+}
+
+QRect HabitGrid::streakRect(int row) const
+{
+    QRect lastCell = cellRect(row, daysInMonth);
+    return QRect(lastCell.right() + 1 + CellSpacing, lastCell.top(), StreakWidth, CellSize);
+}
+
+bool HabitGrid::cellAt(const QPoint& pos, int& row, int& day) const
+{
+    int y = pos.y() + verticalScrollBar()->value() - Margin;
+    if (y < 0) {
+        return false;
+    }
+    
+    row = y / RowPitch;
+    if (row >= rowCount()) {
+        return false;
+    }
+    
+    QRect first = cellRect(row, 1);
+    if (pos.x() < first.left()) {
+        return false;
+    }
+    
+    day = (pos.x() - first.left()) / (CellSize + CellSpacing) + 1;
+    return day <= daysInMonth && cellRect(row, day).contains(pos);
+}
+
+// День месяца для даты из показанного месяца, иначе 0.
+int HabitGrid::dayOf(const QDate& date) const
+{
+    qint64 offset = firstDay.daysTo(date);
+    return (offset >= 0 && offset < daysInMonth) ? int(offset) + 1 : 0;
+}
+
+void HabitGrid::setFocusCell(int row, int day)
+{
+    if (row != focusRow || day != focusDay) {
+        viewport()->update(cellRect(focusRow, focusDay));
+        focusRow = row;
+        focusDay = day;
+    }
+    ensureCellVisible(focusRow, focusDay);
+    viewport()->update(cellRect(focusRow, focusDay));
+}
+
+void HabitGrid::ensureCellVisible(int row, int day)
+{
+    QRect cell = cellRect(row, day).adjusted(-RowPadding, -RowPadding, RowPadding, RowPadding);
+    
+    if (cell.top() < 0) {
+        verticalScrollBar()->setValue(verticalScrollBar()->value() + cell.top());
+    } else if (cell.bottom() > viewport()->height()) {
+        verticalScrollBar()->setValue(verticalScrollBar()->value() + cell.bottom() - viewport()->height());
+    }
+    
+    if (cell.left() < 0) {
+        horizontalScrollBar()->setValue(horizontalScrollBar()->value() + cell.left());
+    } else if (cell.right() > viewport()->width()) {
+        horizontalScrollBar()->setValue(horizontalScrollBar()->value() + cell.right() - viewport()->width());
+    }
+}
+
+void HabitGrid::updateScrollBars()
+{
+    QSize area = viewport()->size();
+    
+    verticalScrollBar()->setRange(0, qMax(0, contentHeight() - area.height()));
+    verticalScrollBar()->setPageStep(area.height());
+    verticalScrollBar()->setSingleStep(RowPitch);
+    
+    horizontalScrollBar()->setRange(0, qMax(0, contentWidth() - area.width()));
+    horizontalScrollBar()->setPageStep(area.width());
+    horizontalScrollBar()->setSingleStep(CellSize + CellSpacing);
+}
+
+// Просит модель загрузить строки окна с запасом по OverscanRows с каждой стороны.
+void HabitGrid::fetchVisibleRows()
+{
+    if (rowCount() == 0) {
+        return;
+    }
+    
+    int top = verticalScrollBar()->value() - Margin;
+    int first = qMax(0, top / RowPitch);
+    int last = (top + viewport()->height()) / RowPitch;
+    model->fetchRows(first - OverscanRows, last + OverscanRows);
+}
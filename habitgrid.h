@@ -0,0 +1,93 @@
+#ifndef HABITGRID_H
+#define HABITGRID_H
+
+#include <QAbstractScrollArea>
+#include <QDate>
+#include <QFont>
+#include <QFontMetrics>
+#include "habitmodel.h"
+
+// Привычки за месяц, нарисованные одним виджетом: в строке имя привычки, ячейки дней и серия.
+// Данные берутся из HabitModel; рисуются и запрашиваются у модели только строки, попавшие
+// в окно прокрутки (с небольшим запасом), поэтому время кадра не зависит от числа привычек.
+// Смена одной отметки перерисовывает одну ячейку. Стрелки двигают выделенную ячейку,
+// пробел или Enter переключают её.
+class HabitGrid : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit HabitGrid(QWidget *parent = nullptr);
+
+    void setModel(HabitModel *model);
+
+    // Месяц, который показывает сетка; дни после today нельзя отметить.
+    void setMonth(const QDate& firstDay, const QDate& today);
+
+    bool hasHabit(int habitId) const { return model && model->rowOf(habitId) >= 0; }
+
+    bool isCompleted(int habitId, const QDate& date) const;
+
+    void setCompleted(int habitId, const QDate& date, bool completed);
+
+signals:
+    void dayToggled(int habitId, const QDate& date);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void focusInEvent(QFocusEvent *event) override;
+    void focusOutEvent(QFocusEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+
+private slots:
+    void onModelReset();
+    void onDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QList<int>& roles);
+
+private:
+    static constexpr int Margin = 10;
+    static constexpr int CellSize = 25;
+    static constexpr int CellSpacing = 5;
+    static constexpr int RowSpacing = 5;
+    static constexpr int RowPadding = 5;
+    static constexpr int RowHeight = CellSize + 2 * RowPadding;
+    static constexpr int RowPitch = RowHeight + RowSpacing;
+    static constexpr int NameWidth = 150;
+    static constexpr int StreakWidth = 50;
+    // Строки за краем окна, которые загружаются заранее, чтобы прокрутка не упиралась в базу.
+    static constexpr int OverscanRows = 10;
+
+    int rowCount() const { return model ? model->rowCount() : 0; }
+    int contentWidth() const;
+    int contentHeight() const;
+    // Прямоугольники в координатах viewport с учётом прокрутки.
+    QRect rowRect(int row) const;
+    QRect nameRect(int row) const;
+    QRect cellRect(int row, int day) const;
+    QRect streakRect(int row) const;
+    bool cellAt(const QPoint& pos, int& row, int& day) const;
+    int dayOf(const QDate& date) const;
+    bool isFuture(int day) const { return day > lastOpenDay; }
+    void paintRow(QPainter& painter, int row, const QRect& dirty) const;
+    void setFocusCell(int row, int day);
+    void ensureCellVisible(int row, int day);
+    void updateScrollBars();
+    void fetchVisibleRows();
+
+    HabitModel *model;
+    QDate firstDay;
+    QDate today;
+    int daysInMonth;
+    // Последний день месяца, который уже можно отметить.
+    int lastOpenDay;
+    int focusRow;
+    int focusDay;
+    QFont nameFont;
+    QFont dayFont;
+    QFont completedDayFont;
+    QFontMetrics nameMetrics;
+};
+
+#endif
@@ -0,0 +1,152 @@
+#include "habitmodel.h"
+#include "database.h"
+#include "databaseworker.h"
+
+HabitModel::HabitModel(QObject *parent)
+    : QAbstractListModel(parent), loadGeneration(0)
+{
+}
+
+void HabitModel::setHabits(const std::vector<HabitRecord>& habits, const QDate& firstDay)
+{
+    beginResetModel();
+    ++loadGeneration;
+    this->firstDay = firstDay;
+    
+    rows.clear();
+    rows.reserve(habits.size());
+    rowsById.clear();
+    for (const HabitRecord& habit : habits) {
+        Row row;
+        row.id = habit.id;
+        row.name = habit.name;
+        rowsById.insert(habit.id, int(rows.size()));
+        rows.push_back(std::move(row));
+    }
+    endResetModel();
+}
+
+void HabitModel::clear()
+{
+    setHabits({}, firstDay);
+}
+
+bool HabitModel::setCompleted(int row, int day, bool completed)
+{
+    if (row < 0 || row >= int(rows.size()) || !isLoaded(row) || day < 1 || day > 31) {
+        return false;
+    }
+    
+    quint32& bits = rows[row].completed;
+    quint32 updated = completed ? (bits | (1u << (day - 1))) : (bits & ~(1u << (day - 1)));
+    if (updated == bits) {
+        return false;
+    }
+    
+    bits = updated;
+    emit dataChanged(index(row), index(row), {CompletedRole});
+    return true;
+}
+
+void HabitModel::setStreak(int row, const HabitStreak& streak)
+{
+    if (row < 0 || row >= int(rows.size()) || !isLoaded(row)) {
+        return;
+    }
+    
+    rows[row].streak = streak;
+    emit dataChanged(index(row), index(row), {StreakRole});
+}
+
+void HabitModel::fetchRows(int first, int last)
+{
+    first = qMax(first, 0);
+    last = qMin(last, int(rows.size()) - 1);
+    
+    std::vector<int> ids;
+    for (int row = first; row <= last; ++row) {
+        if (rows[row].state == State::Unloaded) {
+            rows[row].state = State::Loading;
+            ids.push_back(rows[row].id);
+        }
+    }
+    if (ids.empty()) {
+        return;
+    }
+    
+    int generation = loadGeneration;
+    QDate from = firstDay;
+    DatabaseWorker::instance().run([ids, from](Database& db) {
+        std::vector<LoadedHabit> loaded;
+        loaded.reserve(ids.size());
+        for (int id : ids) {
+            LoadedHabit habit;
+            habit.id = id;
+            for (const QDate& date : db.getHabitCompletions(id, from, from.addMonths(1))) {
+                habit.completed |= 1u << (date.day() - 1);
+            }
+            habit.streak = db.getHabitStreak(id);
+            loaded.push_back(habit);
+        }
+        return loaded;
+    }).then(this, [this, generation](const std::vector<LoadedHabit>& loaded) {
+        if (generation != loadGeneration) {
+            return;
+        }
+    
+        int firstChanged = int(rows.size());
+        int lastChanged = -1;
+        for (const LoadedHabit& habit : loaded) {
+            int row = rowOf(habit.id);
+            if (row < 0) {
+                continue;
+            }
+            rows[row].completed = habit.completed;
+            rows[row].streak = habit.streak;
+            rows[row].state = State::Loaded;
+            firstChanged = qMin(firstChanged, row);
+            lastChanged = qMax(lastChanged, row);
+        }
+    
+        if (lastChanged >= 0) {
+            emit dataChanged(index(firstChanged), index(lastChanged), {CompletedRole, StreakRole, LoadedRole});
+        }
+    });
+}
+
+int HabitModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : int(rows.size());
+}
+
+QVariant HabitModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= int(rows.size())) {
+        return QVariant();
+    }
+    
+    const Row& row = rows[index.row()];
+    switch (role) {
+    case Qt::DisplayRole:
+        return row.name;
+    case HabitIdRole:
+        return row.id;
+    case CompletedRole:
+        return row.completed;
+    case StreakRole:
+        return row.streak.currentLength(QDate::currentDate());
+    case LoadedRole:
+        return row.state == State::Loaded;
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> HabitModel::roleNames() const
+{
+    QHash<int, QByteArray> names = QAbstractListModel::roleNames();
+    names.insert(HabitIdRole, "habitId");
+    names.insert(CompletedRole, "completed");
+    names.insert(StreakRole, "streak");
+    names.insert(LoadedRole, "loaded");
+    return names;
+}
@@ -0,0 +1,89 @@
+#ifndef HABITMODEL_H
+#define HABITMODEL_H
+
+#include <QAbstractListModel>
+#include <QDate>
+#include <QHash>
+#include <vector>
+#include "records.h"
+#include "habitstreak.h"
+
+// Привычки пользователя за один месяц. Список привычек (id и имя) загружается целиком, а отметки
+// месяца и серии — только для строк, которые просит показать представление (fetchRows), так что
+// стоимость загрузки и памяти определяется окном на экране, а не числом привычек.
+class HabitModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Role {
+        HabitIdRole = Qt::UserRole + 1,
+        CompletedRole,
+        StreakRole,
+        LoadedRole
+    };
+
+    explicit HabitModel(QObject *parent = nullptr);
+
+    void setHabits(const std::vector<HabitRecord>& habits, const QDate& firstDay);
+
+    void clear();
+
+    QDate month() const { return firstDay; }
+
+    // -1, если привычки нет в модели.
+    int rowOf(int habitId) const { return rowsById.value(habitId, -1); }
+
+    int habitId(int row) const { return rows[row].id; }
+
+    const QString& name(int row) const { return rows[row].name; }
+
+    bool isLoaded(int row) const { return rows[row].state == State::Loaded; }
+
+    // Бит N — день месяца N + 1.
+    quint32 completedDays(int row) const { return rows[row].completed; }
+
+    const HabitStreak& streak(int row) const { return rows[row].streak; }
+
+    // Возвращает false, если отметка уже была такой или строка ещё не загружена.
+    bool setCompleted(int row, int day, bool completed);
+
+    void setStreak(int row, const HabitStreak& streak);
+
+    // Загружает отметки и серии строк [first, last], которые ещё не загружены и не загружаются.
+    void fetchRows(int first, int last);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    QHash<int, QByteArray> roleNames() const override;
+
+private:
+    enum class State : quint8 {
+        Unloaded,
+        Loading,
+        Loaded
+    };
+
+    struct Row {
+        int id = -1;
+        QString name;
+        quint32 completed = 0;
+        HabitStreak streak;
+        State state = State::Unloaded;
+    };
+
+    struct LoadedHabit {
+        int id = -1;
+        quint32 completed = 0;
+        HabitStreak streak;
+    };
+
+    std::vector<Row> rows;
+    QHash<int, int> rowsById;
+    QDate firstDay;
+    int loadGeneration;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef HABITSTREAK_H
+#define HABITSTREAK_H
+
+#include <QDate>
+
+// Последняя непрерывная серия отметок привычки: дата последней отметки и длина серии.
+// applyMark/applyUnmark возвращают false, если серию нельзя обновить без полного пересчёта.
+struct HabitStreak
+{
+    QDate lastCompletion;
+    int length = 0;
+
+    int currentLength(const QDate& today) const
+    {
+        return lastCompletion == today ? length : 0;
+    }
+
+    bool applyMark(const QDate& date)
+    {
+        if (!lastCompletion.isValid() || date > lastCompletion.addDays(1)) {
+            lastCompletion = date;
+            length = 1;
+            return true;
+        }
+
+        if (date == lastCompletion.addDays(1)) {
+            lastCompletion = date;
+            ++length;
+            return true;
+        }
+
+        QDate runStart = lastCompletion.addDays(-(length - 1));
+        if (date >= runStart) {
+            return true;
+        }
+
+        return date < runStart.addDays(-1);
+    }
+
+    bool applyUnmark(const QDate& date)
+    {
+        if (!lastCompletion.isValid() || date > lastCompletion) {
+            return true;
+        }
+
+        QDate runStart = lastCompletion.addDays(-(length - 1));
+        if (date < runStart) {
+            return true;
+        }
+
+        if (date == lastCompletion) {
+            if (length == 1) {
+                return false;
+            }
+            lastCompletion = date.addDays(-1);
+            --length;
+            return true;
+        }
+
+        length = int(date.daysTo(lastCompletion));
+        return true;
+    }
+};
+
+#endif
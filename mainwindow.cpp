@@ -1,5 +1,7 @@
 #include "mainwindow.h"
 #include "database.h"
+#include "databaseworker.h"
+#include "taskrepository.h"
 #include "taskdialog.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -10,10 +12,9 @@
 #include <QSystemTrayIcon>
 #include <QStyle>
 #include <QSettings>
-#include <QSet>
 
 MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent), isMonthView(false)
+    : QMainWindow(parent), isMonthView(false), lastCleanupUserId(-1)
 {
     setWindowTitle("Планировщик задач");
     resize(1200, 700);
@@ -22,18 +23,20 @@ MainWindow::MainWindow(QWidget *parent)
     if (!db.initialize()) {
         QMessageBox::critical(this, "Ошибка", "Не удалось инициализировать базу данных");
     }
+    DatabaseWorker::instance().start();
     
     QSettings settings;
     notificationsEnabled = settings.value("notificationsEnabled", false).toBool();
     
     setupUI();
+    setupNotifications();
     updateAuthButton();
     updateNotificationsButton();
-    setupNotifications();
 }
 
 MainWindow::~MainWindow()
 {
+    DatabaseWorker::instance().stop();
 }
 
 void MainWindow::setupUI()
@@ -70,13 +73,16 @@ void MainWindow::setupUI()
     bottomLayout->addWidget(notificationsButton);
     mainLayout->addLayout(bottomLayout);
     
-    weekView = new WeekView;
+    // Одна модель на три представления: период в ней задаёт то, которое сейчас показано.
+    taskModel = new TaskModel(this);
+    
+    weekView = new WeekView(taskModel);
     stackedWidget->addWidget(weekView);
     
-    monthView = new MonthView;
+    monthView = new MonthView(taskModel);
     stackedWidget->addWidget(monthView);
     
-    dayView = new DayView;
+    dayView = new DayView(taskModel);
     stackedWidget->addWidget(dayView);
     
     notesView = new NotesView;
@@ -91,6 +97,14 @@ void MainWindow::setupUI()
     trackersView = new TrackersView;
     stackedWidget->addWidget(trackersView);
     
+    refreshScheduler = new RefreshScheduler(stackedWidget, this);
+    refreshScheduler->addView(weekView, [this]() { weekView->refreshWeek(); });
+    refreshScheduler->addView(monthView, [this]() { monthView->refreshMonth(); });
+    refreshScheduler->addView(dayView, [this]() { dayView->refreshTasks(); });
+    refreshScheduler->addView(notesView, [this]() { notesView->refreshNotes(); });
+    refreshScheduler->addView(allNotesView, [this]() { allNotesView->refreshNotes(); });
+    refreshScheduler->addView(trackersView, [this]() { trackersView->refreshTrackers(); });
+    
     authDialog = new AuthDialog(this);
     
     connect(authButton, &QPushButton::clicked, this, &MainWindow::onAuthButtonClicked);
@@ -105,7 +119,6 @@ void MainWindow::setupUI()
     connect(monthView, &MonthView::dayClicked, this, &MainWindow::onDayClicked);
     connect(monthView, &MonthView::addTaskRequested, this, &MainWindow::onAddTaskRequested);
     connect(dayView, &DayView::backRequested, this, &MainWindow::onDayViewBack);
-    connect(dayView, &DayView::taskAdded, this, &MainWindow::onTaskAdded);
     connect(notesView, &NotesView::noteClicked, this, &MainWindow::onNoteClicked);
     connect(notesView, &NotesView::backRequested, this, &MainWindow::onNotesViewBack);
     connect(noteEditView, &NoteEditView::backRequested, this, &MainWindow::onNoteEditBack);
@@ -124,7 +137,10 @@ void MainWindow::updateAuthButton()
     } else {
         authButton->setText("Войти");
     }
-    weekView->refreshWeek();
+    // Сменился пользователь: устарели все представления, но перестроится только показанное.
+    refreshScheduler->requestRefreshAll();
+    reminderScheduler->reload();
+    cleanupOldData();
 }
 
 void MainWindow::onAuthButtonClicked()
@@ -147,7 +163,6 @@ void MainWindow::onLoginRequested(const QString& username, const QString& passwo
 
         authDialog->hide();
         updateAuthButton();
-        weekView->refreshWeek();
     } else {
 
         QMessageBox::warning(this, "Ошибка", "Неверное имя пользователя или пароль");
@@ -163,7 +178,6 @@ void MainWindow::onRegisterRequested(const QString& username, const QString& pas
         if (db.authenticateUser(username, password)) {
             authDialog->hide();
             updateAuthButton();
-            weekView->refreshWeek();
             QMessageBox::information(this, "Успех", "Регистрация прошла успешно");
         }
     } else {
@@ -192,13 +206,12 @@ void MainWindow::onAddTaskRequested(const QDate& date)
     
     TaskDialog dialog(date, this);
     if (dialog.exec() == QDialog::Accepted) {
-        if (db.createTask(db.getCurrentUserId(), dialog.getTitle(), 
-                         dialog.getDateTime(), dialog.isTimeBound(), 
-                         dialog.getRecurrence())) {
-            weekView->refreshWeek();
-        } else {
-            QMessageBox::warning(this, "Ошибка", "Не удалось создать задачу");
-        }
+        TaskRepository::instance().createTask(dialog.getTitle(), dialog.getDateTime(),
+                                              dialog.isTimeBound(), dialog.getRecurrence()).then(this, [this](bool created) {
+            if (!created) {
+                QMessageBox::warning(this, "Ошибка", "Не удалось создать задачу");
+            }
+        });
     }
 }
 
@@ -207,18 +220,11 @@ void MainWindow::onDayViewBack()
     showWeekView();
 }
 
-void MainWindow::onTaskAdded(const QDate& date)
-{
-    weekView->refreshWeek();
-    if (isMonthView) {
-        monthView->refreshMonth();
-    }
-}
-
 void MainWindow::showWeekView()
 {
     stackedWidget->setCurrentWidget(weekView);
-    weekView->refreshWeek();
+    refreshScheduler->requestRefresh(weekView);
+    cleanupOldData();
 }
 
 void MainWindow::showDayView(const QDate& date)
@@ -250,7 +256,23 @@ void MainWindow::onMonthButtonClicked()
 void MainWindow::showMonthView()
 {
     stackedWidget->setCurrentWidget(monthView);
-    monthView->refreshMonth();
+    refreshScheduler->requestRefresh(monthView);
+    cleanupOldData();
+}
+
+// Очистка удаляет данные старше RetentionDays дней до текущей недели, поэтому до смены даты
+// или пользователя повторять её незачем, а навигация по неделям и месяцам не пишет в базу.
+void MainWindow::cleanupOldData()
+{
+    Database& db = Database::instance();
+    QDate today = QDate::currentDate();
+    if (!db.isLoggedIn() || (today == lastCleanupDate && db.getCurrentUserId() == lastCleanupUserId)) {
+        return;
+    }
+    
+    lastCleanupDate = today;
+    lastCleanupUserId = db.getCurrentUserId();
+    TaskRepository::instance().cleanupOldData(today.addDays(1 - today.dayOfWeek()));
 }
 
 void MainWindow::setupNotifications()
@@ -259,12 +281,14 @@ void MainWindow::setupNotifications()
     trayIcon->setIcon(this->style()->standardIcon(QStyle::SP_ComputerIcon));
     trayIcon->setVisible(true);
     
-    notificationTimer = new QTimer(this);
-    connect(notificationTimer, &QTimer::timeout, this, &MainWindow::checkNotifications);
+    reminderScheduler = new ReminderScheduler(this);
+    connect(reminderScheduler, &ReminderScheduler::reminderDue, this, &MainWindow::onReminderDue);
+    connect(reminderScheduler, &ReminderScheduler::remindersMissed, this, &MainWindow::onRemindersMissed);
     
-    if (notificationsEnabled) {
-        notificationTimer->start(10000);
-    }
+    TaskRepository& repository = TaskRepository::instance();
+    connect(&repository, &TaskRepository::tasksChanged, reminderScheduler, &ReminderScheduler::reloadDay);
+    connect(&repository, &TaskRepository::taskSeriesChanged, reminderScheduler, &ReminderScheduler::reload);
+    reminderScheduler->setEnabled(notificationsEnabled);
 }
 
 void MainWindow::updateNotificationsButton()
@@ -285,77 +309,42 @@ void MainWindow::onNotificationsButtonClicked()
     
     updateNotificationsButton();
     
-    if (notificationsEnabled) {
-        notificationTimer->start(10000);
-    } else {
-        notificationTimer->stop();
-    }
+    reminderScheduler->setEnabled(notificationsEnabled);
 }
 
-void MainWindow::checkNotifications()
+void MainWindow::onReminderDue(int taskId, const QString& title)
 {
-    if (!notificationsEnabled) {
-        return;
-    }
+    Q_UNUSED(taskId);
+    
+    trayIcon->showMessage(
+        "Напоминание о задаче",
+        title,
+        QSystemTrayIcon::Information,
+        5000
+    );
+}
+
+void MainWindow::onRemindersMissed(const QStringList& titles)
+{
+    const int shownCount = 5;
     
-    Database& db = Database::instance();
-    if (!db.isLoggedIn()) {
-        return;
+    QStringList lines = titles.mid(0, shownCount);
+    if (titles.size() > shownCount) {
+        lines << QString("и ещё %1").arg(titles.size() - shownCount);
     }
     
-    QDate today = QDate::currentDate();
-    QTime currentTime = QTime::currentTime();
-    
-    auto tasks = db.getTasksForDay(db.getCurrentUserId(), today);
-    
-    for (const auto& task : tasks) {
-        bool isTimeBound = task["is_time_bound"].toBool();
-        
-        if (!isTimeBound) {
-            continue;
-        }
-        
-        if (task["task_time"].isNull()) {
-            continue;
-        }
-        
-        QTime taskTime = task["task_time"].toTime();
-        QString title = task["title"].toString();
-        
-        int taskTotalSeconds = taskTime.hour() * 3600 + taskTime.minute() * 60;
-        int currentTotalSeconds = currentTime.hour() * 3600 + currentTime.minute() * 60 + currentTime.second();
-        
-        int diff = currentTotalSeconds - taskTotalSeconds;
-        if (diff >= 0 && diff <= 10) {
-
-            static QSet<int> notifiedTasks;
-            
-            int taskId = task["id"].toInt();
-            
-            if (!notifiedTasks.contains(taskId)) {
-                notifiedTasks.insert(taskId);
-                
-                trayIcon->showMessage(
-                    "Напоминание о задаче",
-                    title,
-                    QSystemTrayIcon::Information,
-                    5000
-                );
-                
-                static int lastMinute = -1;
-                if (currentTime.minute() != lastMinute) {
-                    notifiedTasks.clear();
-                    lastMinute = currentTime.minute();
-                }
-            }
-        }
-    }
+    trayIcon->showMessage(
+        QString("Пропущенные напоминания: %1").arg(titles.size()),
+        lines.join("\n"),
+        QSystemTrayIcon::Information,
+        10000
+    );
 }
 
 void MainWindow::showNotesView()
 {
     stackedWidget->setCurrentWidget(notesView);
-    notesView->refreshNotes();
+    refreshScheduler->requestRefresh(notesView);
 }
 
 void MainWindow::showNoteEditView(int noteId)
@@ -391,7 +380,7 @@ void MainWindow::onNoteEditBack()
 void MainWindow::showAllNotesView()
 {
     stackedWidget->setCurrentWidget(allNotesView);
-    allNotesView->refreshNotes();
+    refreshScheduler->requestRefresh(allNotesView);
 }
 
 void MainWindow::onAllNotesButtonClicked()
@@ -411,7 +400,7 @@ void MainWindow::onAllNotesViewBack()
 void MainWindow::showTrackersView()
 {
     stackedWidget->setCurrentWidget(trackersView);
-    trackersView->refreshTrackers();
+    refreshScheduler->requestRefresh(trackersView);
 }
 
 void MainWindow::onTrackersButtonClicked()
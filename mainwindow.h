@@ -4,6 +4,7 @@
 #include <QMainWindow>
 #include <QStackedWidget>
 #include <QPushButton>
+#include "taskmodel.h"
 #include "weekview.h"
 #include "dayview.h"
 #include "monthview.h"
@@ -12,6 +13,8 @@
 #include "allnotesview.h"
 #include "trackersview.h"
 #include "authdialog.h"
+#include "reminderscheduler.h"
+#include "refreshscheduler.h"
 #include <QSystemTrayIcon>
 #include <QTimer>
 #include <QSettings>
@@ -35,13 +38,13 @@ private slots:
     void onDayClicked(const QDate& date);
     void onAddTaskRequested(const QDate& date);
     void onDayViewBack();
-    void onTaskAdded(const QDate& date);
     void onNoteClicked(int noteId);
     void onNotesViewBack();
     void onNoteEditBack();
     void onAllNotesButtonClicked();
     void onAllNotesViewBack();
-    void checkNotifications();
+    void onReminderDue(int taskId, const QString& title);
+    void onRemindersMissed(const QStringList& titles);
 
 private:
     void setupUI();
@@ -53,8 +56,10 @@ private:
     void showNoteEditView(int noteId);
     void showAllNotesView();
     void showTrackersView();
+    void cleanupOldData();
     
     QStackedWidget *stackedWidget;
+    TaskModel *taskModel;
     WeekView *weekView;
     DayView *dayView;
     MonthView *monthView;
@@ -70,9 +75,13 @@ private:
     QPushButton *notificationsButton;
     AuthDialog *authDialog;
     QSystemTrayIcon *trayIcon;
-    QTimer *notificationTimer;
+    ReminderScheduler *reminderScheduler;
+    RefreshScheduler *refreshScheduler;
     bool isMonthView;
     bool notificationsEnabled;
+    // Когда и для кого последний раз чистились старые задачи: не чаще раза в день.
+    QDate lastCleanupDate;
+    int lastCleanupUserId;
     
     void updateNotificationsButton();
     void setupNotifications();
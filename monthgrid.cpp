@@ -0,0 +1,262 @@
+#include "monthgrid.h"
+#include "paintutils.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QMouseEvent>
+#include <QHelpEvent>
+#include <QToolTip>
+
+static const QColor CurrentMonthBackground("#f5f5f5");
+static const QColor CurrentMonthBorder("#ccc");
+static const QColor OtherMonthBackground("#e8e8e8");
+static const QColor OtherMonthBorder("#ddd");
+static const QColor OtherMonthText("#999");
+static const QColor MoreText("#666");
+
+MonthGrid::MonthGrid(QWidget *parent)
+    : QWidget(parent),
+      headerFont(pixelFont(font(), 10, true)),
+      numberFont(pixelFont(font(), 11, true)),
+      taskFont(pixelFont(font(), 8, false)),
+      headerMetrics(headerFont),
+      numberMetrics(numberFont),
+      taskMetrics(taskFont),
+      elideWidth(0)
+{
+    setCursor(Qt::PointingHandCursor);
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+    elideWidth = cellSize().width() - 2 * CellPadding - 2;
+}
+
+void MonthGrid::setDayNames(const QStringList& names)
+{
+    dayNames = names;
+    update(0, 0, width(), Margin + headerHeight());
+}
+
+void MonthGrid::setMonth(const QDate& firstDate, const QDate& month)
+{
+    this->firstDate = firstDate;
+    this->month = month;
+    
+    for (Cell& cell : cells) {
+        cell.texts.clear();
+        cell.titles.clear();
+        cell.elided.clear();
+        cell.hasMore = false;
+    }
+    update();
+}
+
+void MonthGrid::setDayTasks(int cell, const QStringList& texts, const QStringList& titles, bool hasMore)
+{
+    if (cell < 0 || cell >= CellCount) {
+        return;
+    }
+    
+    Cell& c = cells[cell];
+    c.texts = texts;
+    c.titles = titles;
+    c.hasMore = hasMore;
+    elide(c);
+    update(cellRect(cell));
+}
+
+int MonthGrid::cellIndex(const QDate& date) const
+{
+    if (!firstDate.isValid()) {
+        return -1;
+    }
+    
+    qint64 days = firstDate.daysTo(date);
+    return (days >= 0 && days < CellCount) ? int(days) : -1;
+}
+
+bool MonthGrid::isCurrentMonth(int cell) const
+{
+    QDate date = cellDate(cell);
+    return date.year() == month.year() && date.month() == month.month();
+}
+
+QSize MonthGrid::sizeHint() const
+{
+    return QSize(2 * Margin + Columns * MaxCellWidth + (Columns - 1) * Spacing,
+                 2 * Margin + headerHeight() + Rows * (MaxCellHeight + Spacing));
+}
+
+QSize MonthGrid::minimumSizeHint() const
+{
+    return QSize(2 * Margin + Columns * MinCellWidth + (Columns - 1) * Spacing,
+                 2 * Margin + headerHeight() + Rows * (MinCellHeight + Spacing));
+}
+
+bool MonthGrid::event(QEvent *event)
+{
+    if (event->type() == QEvent::ToolTip) {
+        QHelpEvent *helpEvent = static_cast<QHelpEvent*>(event);
+        int cell = cellAt(helpEvent->pos());
+        if (cell >= 0 && isCurrentMonth(cell)) {
+            const Cell& c = cells[cell];
+            for (int row = 0; row < qMin(int(c.titles.size()), MaxVisibleTasks); ++row) {
+                QRect rect = taskRect(cell, row);
+                if (rect.contains(helpEvent->pos())) {
+                    QToolTip::showText(helpEvent->globalPos(), c.titles[row], this, rect);
+                    return true;
+                }
+            }
+        }
+        QToolTip::hideText();
+        event->ignore();
+        return true;
+    }
+    return QWidget::event(event);
+}
+
+void MonthGrid::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(this);
+    const QRect& dirty = event->rect();
+    const QColor textColor = palette().color(QPalette::WindowText);
+    QSize size = cellSize();
+    
+    painter.setFont(headerFont);
+    painter.setPen(textColor);
+    for (int column = 0; column < Columns; ++column) {
+        QRect rect(cellRect(column).left(), Margin, size.width(), headerHeight());
+        if (rect.intersects(dirty)) {
+            painter.drawText(rect, Qt::AlignCenter, dayNames.value(column));
+        }
+    }
+    
+    if (!firstDate.isValid()) {
+        return;
+    }
+    
+    for (int cell = 0; cell < CellCount; ++cell) {
+        QRect rect = cellRect(cell);
+        if (!rect.intersects(dirty)) {
+            continue;
+        }
+    
+        bool current = isCurrentMonth(cell);
+        painter.fillRect(rect, current ? CurrentMonthBackground : OtherMonthBackground);
+        painter.setPen(current ? CurrentMonthBorder : OtherMonthBorder);
+        painter.drawRect(rect.adjusted(0, 0, -1, -1));
+    
+        QRect inner = rect.adjusted(CellPadding, CellPadding, -CellPadding, -CellPadding);
+        painter.setClipRect(inner);
+    
+        painter.setFont(numberFont);
+        painter.setPen(current ? textColor : OtherMonthText);
+        painter.drawText(QRect(inner.left(), inner.top(), inner.width(), numberMetrics.height()),
+                         Qt::AlignLeft | Qt::AlignVCenter, QString::number(cellDate(cell).day()));
+    
+        if (current) {
+            const Cell& c = cells[cell];
+            int visible = qMin(int(c.elided.size()), MaxVisibleTasks);
+    
+            painter.setFont(taskFont);
+            painter.setPen(textColor);
+            for (int row = 0; row < visible; ++row) {
+                painter.drawText(taskRect(cell, row).adjusted(1, 0, -1, 0),
+                                 Qt::AlignLeft | Qt::AlignVCenter, c.elided[row]);
+            }
+    
+            if (c.hasMore) {
+                painter.setPen(MoreText);
+                painter.drawText(taskRect(cell, visible), Qt::AlignCenter, "...");
+            }
+        }
+    
+        painter.setClipping(false);
+    }
+}
+
+void MonthGrid::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton) {
+        int cell = cellAt(event->position().toPoint());
+        if (cell >= 0) {
+            emit dayClicked(cellDate(cell));
+            return;
+        }
+    }
+    QWidget::mousePressEvent(event);
+}
+
+void MonthGrid::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    
+    int width = cellSize().width() - 2 * CellPadding - 2;
+    if (width != elideWidth) {
+        elideWidth = width;
+        for (Cell& cell : cells) {
+            elide(cell);
+        }
+    }
+}
+
+QSize MonthGrid::cellSize() const
+{
+    int cellWidth = (width() - 2 * Margin - (Columns - 1) * Spacing) / Columns;
+    int cellHeight = (height() - 2 * Margin - headerHeight() - Rows * Spacing) / Rows;
+    return QSize(qBound(MinCellWidth, cellWidth, MaxCellWidth),
+                 qBound(MinCellHeight, cellHeight, MaxCellHeight));
+}
+
+// Сетка прижата к верху и выровнена по центру, если ячейки упёрлись в максимальный размер.
+QRect MonthGrid::cellRect(int cell) const
+{
+    QSize size = cellSize();
+    int gridWidth = Columns * size.width() + (Columns - 1) * Spacing;
+    int left = qMax(Margin, (width() - gridWidth) / 2);
+    int top = Margin + headerHeight() + Spacing;
+    int row = cell / Columns;
+    int column = cell % Columns;
+    return QRect(left + column * (size.width() + Spacing), top + row * (size.height() + Spacing),
+                 size.width(), size.height());
+}
+
+QRect MonthGrid::taskRect(int cell, int row) const
+{
+    QRect inner = cellRect(cell).adjusted(CellPadding, CellPadding, -CellPadding, -CellPadding);
+    int top = inner.top() + numberMetrics.height() + 2 + row * (taskLineHeight() + 1);
+    return QRect(inner.left(), top, inner.width(), taskLineHeight());
+}
+
+int MonthGrid::cellAt(const QPoint& pos) const
+{
+    QRect first = cellRect(0);
+    if (pos.x() < first.left() || pos.y() < first.top()) {
+        return -1;
+    }
+    
+    int column = (pos.x() - first.left()) / (first.width() + Spacing);
+    int row = (pos.y() - first.top()) / (first.height() + Spacing);
+    if (column >= Columns || row >= Rows) {
+        return -1;
+    }
+    
+    // Промежутки между ячейками не относятся ни к одной из них.
+    int cell = row * Columns + column;
+    return cellRect(cell).contains(pos) ? cell : -1;
+}
+
+void MonthGrid::elide(Cell& cell) const
+{
+    cell.elided.clear();
+    for (const QString& text : cell.texts) {
+        cell.elided.append(taskMetrics.elidedText(text, Qt::ElideRight, elideWidth));
+    }
+}
+
+int MonthGrid::headerHeight() const
+{
+    return headerMetrics.height() + 4;
+}
+
+int MonthGrid::taskLineHeight() const
+{
+    return taskMetrics.height() + 2;
+}
@@ -0,0 +1,92 @@
+#ifndef MONTHGRID_H
+#define MONTHGRID_H
+
+#include <QWidget>
+#include <QDate>
+#include <QFont>
+#include <QFontMetrics>
+#include <QStringList>
+#include <array>
+
+// Сетка месяца 7×6, нарисованная одним виджетом. Смена месяца только меняет данные ячеек
+// и перерисовывает сетку, без создания виджетов и разбора стилей. Усечённые подписи задач
+// считаются по закэшированным QFontMetrics и пересчитываются лишь при смене ширины ячейки.
+class MonthGrid : public QWidget
+{
+    Q_OBJECT
+
+public:
+    static constexpr int Columns = 7;
+    static constexpr int Rows = 6;
+    static constexpr int CellCount = Columns * Rows;
+    static constexpr int MaxVisibleTasks = 2;
+
+    explicit MonthGrid(QWidget *parent = nullptr);
+
+    void setDayNames(const QStringList& names);
+
+    // Ячейки идут подряд с firstDate; дни вне месяца month рисуются приглушёнными и без задач.
+    void setMonth(const QDate& firstDate, const QDate& month);
+
+    // Подписи первых задач дня, их полные названия для подсказок и признак, что задач больше.
+    void setDayTasks(int cell, const QStringList& texts, const QStringList& titles, bool hasMore);
+
+    // -1, если дня нет в сетке.
+    int cellIndex(const QDate& date) const;
+
+    QDate cellDate(int cell) const { return firstDate.addDays(cell); }
+
+    bool isCurrentMonth(int cell) const;
+
+    QSize sizeHint() const override;
+
+    QSize minimumSizeHint() const override;
+
+signals:
+    void dayClicked(const QDate& date);
+
+protected:
+    bool event(QEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+
+private:
+    static constexpr int Margin = 10;
+    static constexpr int Spacing = 5;
+    static constexpr int CellPadding = 3;
+    static constexpr int MinCellWidth = 80;
+    static constexpr int MaxCellWidth = 120;
+    static constexpr int MinCellHeight = 60;
+    static constexpr int MaxCellHeight = 100;
+
+    struct Cell {
+        QStringList texts;
+        QStringList titles;
+        QStringList elided;
+        bool hasMore = false;
+    };
+
+    QSize cellSize() const;
+    QRect cellRect(int cell) const;
+    QRect taskRect(int cell, int row) const;
+    int cellAt(const QPoint& pos) const;
+    void elide(Cell& cell) const;
+    int headerHeight() const;
+    int taskLineHeight() const;
+
+    QStringList dayNames;
+    QDate firstDate;
+    QDate month;
+    std::array<Cell, CellCount> cells;
+    QFont headerFont;
+    QFont numberFont;
+    QFont taskFont;
+    QFontMetrics headerMetrics;
+    QFontMetrics numberMetrics;
+    QFontMetrics taskMetrics;
+    // Ширина, под которую усечены подписи в cells.
+    int elideWidth;
+};
+
+#endif
@@ -1,10 +1,8 @@
 #include "monthview.h"
 #include "database.h"
+#include "taskrepository.h"
 #include <QLocale>
-#include <QFrame>
 #include <QTime>
-#include <QMouseEvent>
-#include <QEvent>
 #include <QSettings>
 
 static QString getMonthNameNominative(int month)
@@ -19,8 +17,8 @@ static QString getMonthNameNominative(int month)
     return QString();
 }
 
-MonthView::MonthView(QWidget *parent)
-    : QWidget(parent)
+MonthView::MonthView(TaskModel *model, QWidget *parent)
+    : QWidget(parent), taskModel(model)
 {
 
     QVBoxLayout *mainLayout = new QVBoxLayout(this);
@@ -29,8 +27,12 @@ MonthView::MonthView(QWidget *parent)
     monthLabel = new QLabel;
     monthLabel->setStyleSheet("font-size: 16px; font-weight: bold;");
     monthLabel->setAlignment(Qt::AlignCenter);
+    loadingLabel = new QLabel("Загрузка...");
+    loadingLabel->setStyleSheet("font-size: 10px; color: #888;");
+    loadingLabel->hide();
     labelLayout->addStretch();
     labelLayout->addWidget(monthLabel);
+    labelLayout->addWidget(loadingLabel);
     labelLayout->addStretch();
     mainLayout->addLayout(labelLayout);
     
@@ -43,10 +45,7 @@ MonthView::MonthView(QWidget *parent)
     prevButton->setMaximumWidth(50);
     gridContainerLayout->addWidget(prevButton);
     
-    QWidget *gridContainer = new QWidget;
-    gridLayout = new QGridLayout(gridContainer);
-    gridLayout->setSpacing(5);
-    gridLayout->setContentsMargins(10, 10, 10, 10);
+    grid = new MonthGrid;
     
     QLocale locale(QLocale::Russian);
     QSettings settings;
@@ -61,27 +60,26 @@ MonthView::MonthView(QWidget *parent)
         dayNames = {"Пн", "Вт", "Ср", "Чт", "Пт", "Сб", "Вс"};
     }
     
-    for (int i = 0; i < 7; ++i) {
-        QLabel *dayNameLabel = new QLabel(dayNames[i]);
-        dayNameLabel->setAlignment(Qt::AlignCenter);
-
-        dayNameLabel->setStyleSheet("font-weight: bold; font-size: 10px; padding: 2px;");
-        gridLayout->addWidget(dayNameLabel, 0, i);
-    }
+    grid->setDayNames(dayNames);
     
-    dayWidgets.resize(42);
-    
-    gridContainerLayout->addWidget(gridContainer, 1);
+    gridContainerLayout->addWidget(grid, 1);
     
     nextButton = new QPushButton("→");
     nextButton->setMinimumWidth(50);
     nextButton->setMaximumWidth(50);
     gridContainerLayout->addWidget(nextButton);
     
+    prevButton->setAutoRepeat(true);
+    nextButton->setAutoRepeat(true);
+    
     mainLayout->addLayout(gridContainerLayout);
     
     connect(prevButton, &QPushButton::clicked, this, &MonthView::onPrevMonthClicked);
     connect(nextButton, &QPushButton::clicked, this, &MonthView::onNextMonthClicked);
+    connect(grid, &MonthGrid::dayClicked, this, &MonthView::dayClicked);
+    
+    connect(taskModel, &QAbstractItemModel::modelReset, this, &MonthView::onModelReset);
+    connect(taskModel, &TaskModel::dayChanged, this, &MonthView::onDayChanged);
     
     setMonth(QDate::currentDate());
 }
@@ -117,18 +115,46 @@ void MonthView::refreshMonth()
     int firstWeekday = getFirstWeekday(firstDay);
     int daysInMonth = getDaysInMonth(currentMonth);
     
-    QDate currentDate = firstDay.addDays(-firstWeekday);
+    // Смена месяца только перерисовывает сетку: ячейки не пересоздаются.
+    grid->setMonth(firstDay.addDays(-firstWeekday), currentMonth);
+    
+    loadTasks(firstDay, firstDay.addDays(daysInMonth - 1));
+}
+
+void MonthView::loadTasks(const QDate& from, const QDate& to)
+{
+    loadingLabel->setVisible(Database::instance().isLoggedIn());
+    taskModel->setRange(from, to);
+    
+    if (!Database::instance().isLoggedIn()) {
+        return;
+    }
     
-    for (int i = 0; i < 42; ++i) {
+    // Соседние месяцы загружаются заранее, чтобы переход по стрелкам не ждал базу.
+    TaskRepository& repository = TaskRepository::instance();
+    if (canGoBack()) {
+        repository.prefetch(from.addMonths(-1), from.addDays(-1));
+    }
+    repository.prefetch(from.addMonths(1), from.addMonths(2).addDays(-1));
+}
 
-        bool isCurrentMonth = (currentDate.month() == currentMonth.month() && 
-                              currentDate.year() == currentMonth.year());
-        
-        setupDayWidget(i, currentDate, isCurrentMonth);
-        
+void MonthView::onModelReset()
+{
+    if (!taskModel->hasRange(currentMonth, currentMonth.addDays(currentMonth.daysInMonth() - 1))) {
+        return;
+    }
+    
+    for (int i = 0; i < MonthGrid::CellCount; ++i) {
         refreshDayWidget(i);
-        
-        currentDate = currentDate.addDays(1);
+    }
+    loadingLabel->hide();
+}
+
+void MonthView::onDayChanged(const QDate& date)
+{
+    int cell = grid->cellIndex(date);
+    if (cell >= 0) {
+        refreshDayWidget(cell);
     }
 }
 
@@ -143,119 +169,25 @@ QString MonthView::formatMonthHeader(const QDate& date) const
     return monthName;
 }
 
-void MonthView::setupDayWidget(int index, const QDate& date, bool isCurrentMonth)
-{
-    if (index >= dayWidgets.size()) {
-        return;
-    }
-    
-    DayWidget& dw = dayWidgets[index];
-    
-    if (dw.frame) {
-        gridLayout->removeWidget(dw.frame);
-        delete dw.frame;
-    }
-    
-    dw.date = date;
-    dw.isCurrentMonth = isCurrentMonth;
-    
-    dw.frame = new QFrame;
-    dw.frame->setFrameStyle(QFrame::Box);
-    
-    if (isCurrentMonth) {
-        dw.frame->setStyleSheet("QFrame { background-color: #f5f5f5; border: 1px solid #ccc; }");
-    } else {
-        dw.frame->setStyleSheet("QFrame { background-color: #e8e8e8; border: 1px solid #ddd; }");
-    }
-    
-    dw.frame->setMinimumSize(80, 60);
-    dw.frame->setMaximumSize(120, 100);
-    
-    QVBoxLayout *dayLayout = new QVBoxLayout(dw.frame);
-    dayLayout->setContentsMargins(3, 3, 3, 3);
-    dayLayout->setSpacing(2);
-    
-    dw.dayNumber = new QLabel(QString::number(date.day()));
-    dw.dayNumber->setStyleSheet("font-weight: bold; font-size: 11px;");
-    if (!isCurrentMonth) {
-        dw.dayNumber->setStyleSheet("font-weight: bold; font-size: 11px; color: #999;");
-    }
-    dayLayout->addWidget(dw.dayNumber);
-    
-    dw.tasksLayout = new QVBoxLayout;
-    dw.tasksLayout->setAlignment(Qt::AlignTop);
-    dw.tasksLayout->setSpacing(1);
-    dayLayout->addLayout(dw.tasksLayout);
-    
-    dayLayout->addStretch();
-    
-    dw.frame->installEventFilter(this);
-    dw.frame->setProperty("dayIndex", index);
-    dw.frame->setCursor(Qt::PointingHandCursor);
-    
-    int row = (index / 7) + 1;
-    int col = index % 7;
-    gridLayout->addWidget(dw.frame, row, col);
-}
-
 void MonthView::refreshDayWidget(int index)
 {
-
-    if (index >= dayWidgets.size() || !dayWidgets[index].frame) {
+    if (!grid->isCurrentMonth(index) || !Database::instance().isLoggedIn()) {
+        grid->setDayTasks(index, {}, {}, false);
         return;
     }
     
-    DayWidget& dw = dayWidgets[index];
+    QModelIndex day = taskModel->dayIndex(grid->cellDate(index));
+    int taskCount = day.isValid() ? taskModel->rowCount(day) : 0;
     
-    QLayoutItem* item;
-    while ((item = dw.tasksLayout->takeAt(0)) != nullptr) {
-        delete item->widget();
-        delete item;
+    QStringList texts;
+    QStringList titles;
+    for (int i = 0; i < qMin(taskCount, MonthGrid::MaxVisibleTasks); ++i) {
+        QModelIndex task = taskModel->index(i, 0, day);
+        texts.append(task.data().toString());
+        titles.append(task.data(TaskModel::TitleRole).toString());
     }
     
-    if (!dw.isCurrentMonth) {
-        return;
-    }
-    
-    Database& db = Database::instance();
-    if (!db.isLoggedIn()) {
-        return;
-    }
-    
-    auto tasks = db.getTasksForDay(db.getCurrentUserId(), dw.date);
-    
-    const int MAX_VISIBLE_TASKS = 2;
-    
-    for (int i = 0; i < qMin(tasks.size(), MAX_VISIBLE_TASKS); ++i) {
-        const auto& task = tasks[i];
-        QString title = task["title"].toString();
-        bool isTimeBound = task["is_time_bound"].toBool();
-        QString timeStr;
-        
-        if (isTimeBound && !task["task_time"].isNull()) {
-            QTime time = task["task_time"].toTime();
-            timeStr = time.toString("HH:mm") + " ";
-        }
-        
-        QString displayText = timeStr + title;
-        
-        if (displayText.length() > 15) {
-            displayText = displayText.left(12) + "...";
-        }
-        
-        QLabel *taskLabel = new QLabel(displayText);
-        taskLabel->setWordWrap(false);
-        taskLabel->setStyleSheet("font-size: 8px; padding: 1px;");
-        taskLabel->setToolTip(task["title"].toString());
-        dw.tasksLayout->addWidget(taskLabel);
-    }
-    
-    if (tasks.size() > MAX_VISIBLE_TASKS) {
-        QLabel *moreLabel = new QLabel("...");
-        moreLabel->setStyleSheet("font-size: 8px; color: #666;");
-        moreLabel->setAlignment(Qt::AlignCenter);
-        dw.tasksLayout->addWidget(moreLabel);
-    }
+    grid->setDayTasks(index, texts, titles, taskCount > MonthGrid::MaxVisibleTasks);
 }
 
 int MonthView::getDaysInMonth(const QDate& date) const
@@ -274,12 +206,6 @@ void MonthView::onPrevMonthClicked()
     if (canGoBack()) {
         currentMonth = currentMonth.addMonths(-1);
         refreshMonth();
-        
-        Database& db = Database::instance();
-        if (db.isLoggedIn()) {
-            QDate currentDate = QDate::currentDate();
-            db.cleanupOldData(db.getCurrentUserId(), currentDate);
-        }
     }
 }
 
@@ -287,26 +213,4 @@ void MonthView::onNextMonthClicked()
 {
     currentMonth = currentMonth.addMonths(1);
     refreshMonth();
-    
-    Database& db = Database::instance();
-    if (db.isLoggedIn()) {
-        QDate currentDate = QDate::currentDate();
-        db.cleanupOldData(db.getCurrentUserId(), currentDate);
-    }
-}
-
-bool MonthView::eventFilter(QObject *obj, QEvent *event)
-{
-    if (event->type() == QEvent::MouseButtonPress) {
-        QMouseEvent *mouseEvent = static_cast<QMouseEvent*>(event);
-        if (mouseEvent->button() == Qt::LeftButton) {
-            for (int i = 0; i < dayWidgets.size(); ++i) {
-                if (dayWidgets[i].frame == obj) {
-                    emit dayClicked(dayWidgets[i].date);
-                    return true;
-                }
-            }
-        }
-    }
-    return QWidget::eventFilter(obj, event);
 }
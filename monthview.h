@@ -2,19 +2,20 @@
 #define MONTHVIEW_H
 
 #include <QWidget>
-#include <QGridLayout>
 #include <QPushButton>
 #include <QLabel>
 #include <QDate>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
+#include "monthgrid.h"
+#include "taskmodel.h"
 
 class MonthView : public QWidget
 {
     Q_OBJECT
 
 public:
-    explicit MonthView(QWidget *parent = nullptr);
+    explicit MonthView(TaskModel *model, QWidget *parent = nullptr);
     void refreshMonth();
     
     void setMonth(const QDate& date);
@@ -30,8 +31,14 @@ private slots:
     void onPrevMonthClicked();
     
     void onNextMonthClicked();
+    
+    void onModelReset();
+    
+    void onDayChanged(const QDate& date);
 
 private:
+    TaskModel *taskModel;
+    
     QDate currentMonth;
     
     QDate getFirstDayOfMonth(const QDate& date) const;
@@ -41,29 +48,18 @@ private:
     QPushButton *prevButton;
     QPushButton *nextButton;
     QLabel *monthLabel;
-    QGridLayout *gridLayout;
-    
-    struct DayWidget {
-        QFrame *frame;
-        QLabel *dayNumber;
-        QVBoxLayout *tasksLayout;
-        QDate date;
-        bool isCurrentMonth;
-    };
-    
-    QVector<DayWidget> dayWidgets;
-    
-    void setupDayWidget(int index, const QDate& date, bool isCurrentMonth);
+    QLabel *loadingLabel;
+    MonthGrid *grid;
     
     QString formatMonthHeader(const QDate& date) const;
     
     void refreshDayWidget(int index);
     
+    void loadTasks(const QDate& from, const QDate& to);
+    
     int getDaysInMonth(const QDate& date) const;
     
     int getFirstWeekday(const QDate& date) const;
-    
-    bool eventFilter(QObject *obj, QEvent *event) override;
 };
 
 #endif
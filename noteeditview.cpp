@@ -1,10 +1,11 @@
 #include "noteeditview.h"
 #include "database.h"
+#include "databaseworker.h"
 #include <QMessageBox>
 #include <QTimer>
 
 NoteEditView::NoteEditView(int noteId, QWidget *parent)
-    : QWidget(parent), currentNoteId(noteId), isSaving(false)
+    : QWidget(parent), currentNoteId(noteId), isLoading(false)
 {
 
     QVBoxLayout *layout = new QVBoxLayout(this);
@@ -39,6 +40,8 @@ NoteEditView::NoteEditView(int noteId, QWidget *parent)
     }
 }
 
+// Пока заметка читается, правки полей не сохраняются: ни пустые поля, ни подстановка
+// загруженного текста не должны записываться обратно в базу.
 void NoteEditView::loadNote(int noteId)
 {
     currentNoteId = noteId;
@@ -48,22 +51,33 @@ void NoteEditView::loadNote(int noteId)
         return;
     }
     
-    auto note = db.getNote(noteId);
-    if (note.isEmpty()) {
-        QMessageBox::warning(this, "Ошибка", "Заметка не найдена");
-        emit backRequested();
-        return;
-    }
-    
+    isLoading = true;
     int userId = db.getCurrentUserId();
-    if (note["user_id"].toInt() != userId) {
-        QMessageBox::warning(this, "Ошибка", "Нет доступа к этой заметке");
-        emit backRequested();
-        return;
-    }
-    
-    nameEdit->setText(note["name"].toString());
-    contentEdit->setPlainText(note["content"].toString());
+    DatabaseWorker::instance().run([noteId](Database& db) {
+        return db.getNote(noteId);
+    }).then(this, [this, noteId, userId](const NoteRecord& note) {
+        if (noteId != currentNoteId) {
+            return;
+        }
+        
+        if (note.id < 0) {
+            isLoading = false;
+            QMessageBox::warning(this, "Ошибка", "Заметка не найдена");
+            emit backRequested();
+            return;
+        }
+        
+        if (note.userId != userId) {
+            isLoading = false;
+            QMessageBox::warning(this, "Ошибка", "Нет доступа к этой заметке");
+            emit backRequested();
+            return;
+        }
+        
+        nameEdit->setText(note.name);
+        contentEdit->setPlainText(note.content);
+        isLoading = false;
+    });
 }
 
 void NoteEditView::onBackClicked()
@@ -74,7 +88,7 @@ void NoteEditView::onBackClicked()
 
 void NoteEditView::onNameChanged()
 {
-    if (currentNoteId > 0 && !isSaving) {
+    if (currentNoteId > 0 && !isLoading) {
 
         QTimer::singleShot(500, this, &NoteEditView::saveNote);
     }
@@ -82,7 +96,7 @@ void NoteEditView::onNameChanged()
 
 void NoteEditView::onContentChanged()
 {
-    if (currentNoteId > 0 && !isSaving) {
+    if (currentNoteId > 0 && !isLoading) {
 
         QTimer::singleShot(1000, this, &NoteEditView::saveNote);
     }
@@ -90,7 +104,7 @@ void NoteEditView::onContentChanged()
 
 void NoteEditView::saveNote()
 {
-    if (currentNoteId <= 0 || isSaving) {
+    if (currentNoteId <= 0 || isLoading) {
         return;
     }
     
@@ -106,11 +120,13 @@ void NoteEditView::saveNote()
     
     QString content = contentEdit->toPlainText();
     
-    isSaving = true;
-    bool success = db.updateNote(currentNoteId, name, content);
-    isSaving = false;
-    
-    if (!success) {
-        QMessageBox::warning(this, "Ошибка", "Не удалось сохранить заметку");
-    }
+    // Сохранения выполняются потоком базы по очереди, поэтому последнее из них и остаётся в базе.
+    int noteId = currentNoteId;
+    DatabaseWorker::instance().run([noteId, name, content](Database& db) {
+        return db.updateNote(noteId, name, content);
+    }).then(this, [this](bool saved) {
+        if (!saved) {
+            QMessageBox::warning(this, "Ошибка", "Не удалось сохранить заметку");
+        }
+    });
 }
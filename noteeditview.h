@@ -39,7 +39,7 @@ private:
     QLineEdit *nameEdit;
     QTextEdit *contentEdit;
     QPushButton *backButton;
-    bool isSaving;
+    bool isLoading;
 };
 
 #endif
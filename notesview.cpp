@@ -1,11 +1,13 @@
 #include "notesview.h"
 #include "database.h"
+#include "databaseworker.h"
+#include "databasenotifier.h"
 #include <QMessageBox>
 #include <QInputDialog>
 #include <QLineEdit>
 
 NotesView::NotesView(QWidget *parent)
-    : QWidget(parent)
+    : QWidget(parent), loadGeneration(0)
 {
 
     QVBoxLayout *layout = new QVBoxLayout(this);
@@ -36,10 +38,12 @@ NotesView::NotesView(QWidget *parent)
     connect(addButton, &QPushButton::clicked, this, &NotesView::onAddNoteClicked);
     connect(deleteButton, &QPushButton::clicked, this, &NotesView::onDeleteNoteClicked);
     connect(notesList, &QListWidget::itemDoubleClicked, this, &NotesView::onNoteDoubleClicked);
+    connect(&DatabaseNotifier::instance(), &DatabaseNotifier::noteChanged, this, &NotesView::onNoteChanged);
 }
 
 void NotesView::refreshNotes()
 {
+    int generation = ++loadGeneration;
     notesList->clear();
     
     Database& db = Database::instance();
@@ -48,14 +52,19 @@ void NotesView::refreshNotes()
     }
     
     int userId = db.getCurrentUserId();
-    auto notes = db.getNotes(userId);
-    
-    for (const auto& note : notes) {
-        QString name = note["name"].toString();
-        QListWidgetItem *item = new QListWidgetItem(name);
-        item->setData(Qt::UserRole, note["id"].toInt());
-        notesList->addItem(item);
-    }
+    DatabaseWorker::instance().run([userId](Database& db) {
+        return db.getNotes(userId);
+    }).then(this, [this, generation](const std::vector<NoteRecord>& notes) {
+        if (generation != loadGeneration) {
+            return;
+        }
+        
+        for (const NoteRecord& note : notes) {
+            QListWidgetItem *item = new QListWidgetItem(note.name);
+            item->setData(Qt::UserRole, note.id);
+            notesList->addItem(item);
+        }
+    });
 }
 
 void NotesView::onAddNoteClicked()
@@ -76,15 +85,15 @@ void NotesView::onAddNoteClicked()
     }
     
     int userId = db.getCurrentUserId();
-    int noteId = db.createNote(userId, name);
-    
-    if (noteId > 0) {
-        refreshNotes();
-
-        emit noteClicked(noteId);
-    } else {
-        QMessageBox::warning(this, "Ошибка", "Не удалось создать заметку");
-    }
+    DatabaseWorker::instance().run([userId, name](Database& db) {
+        return db.createNote(userId, name);
+    }).then(this, [this](int noteId) {
+        if (noteId > 0) {
+            emit noteClicked(noteId);
+        } else {
+            QMessageBox::warning(this, "Ошибка", "Не удалось создать заметку");
+        }
+    });
 }
 
 void NotesView::onDeleteNoteClicked()
@@ -104,13 +113,15 @@ void NotesView::onDeleteNoteClicked()
     
     int noteId = selectedItem->data(Qt::UserRole).toInt();
     
-    Database& db = Database::instance();
-    if (db.deleteNote(noteId)) {
-        refreshNotes();
-        QMessageBox::information(this, "Успех", "Заметка удалена");
-    } else {
-        QMessageBox::warning(this, "Ошибка", "Не удалось удалить заметку");
-    }
+    DatabaseWorker::instance().run([noteId](Database& db) {
+        return db.deleteNote(noteId);
+    }).then(this, [this](bool deleted) {
+        if (deleted) {
+            QMessageBox::information(this, "Успех", "Заметка удалена");
+        } else {
+            QMessageBox::warning(this, "Ошибка", "Не удалось удалить заметку");
+        }
+    });
 }
 
 void NotesView::onNoteDoubleClicked(QListWidgetItem* item)
@@ -118,3 +129,45 @@ void NotesView::onNoteDoubleClicked(QListWidgetItem* item)
     int noteId = item->data(Qt::UserRole).toInt();
     emit noteClicked(noteId);
 }
+
+// Строка ищется уже после ответа базы: пока заметка читалась, список мог перезагрузиться.
+void NotesView::onNoteChanged(int noteId)
+{
+    Database& db = Database::instance();
+    if (!db.isLoggedIn()) {
+        return;
+    }
+    
+    int generation = loadGeneration;
+    int userId = db.getCurrentUserId();
+    DatabaseWorker::instance().run([noteId](Database& db) {
+        return db.getNote(noteId);
+    }).then(this, [this, generation, noteId, userId](const NoteRecord& note) {
+        if (generation != loadGeneration) {
+            return;
+        }
+        
+        QListWidgetItem *item = nullptr;
+        for (int i = 0; i < notesList->count(); ++i) {
+            if (notesList->item(i)->data(Qt::UserRole).toInt() == noteId) {
+                item = notesList->item(i);
+                break;
+            }
+        }
+        
+        if (note.id < 0 || note.userId != userId) {
+            delete item;
+            return;
+        }
+        
+        // Список упорядочен по времени изменения, поэтому изменённая заметка переезжает наверх.
+        if (item) {
+            notesList->takeItem(notesList->row(item));
+        } else {
+            item = new QListWidgetItem;
+            item->setData(Qt::UserRole, note.id);
+        }
+        item->setText(note.name);
+        notesList->insertItem(0, item);
+    });
+}
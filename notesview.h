@@ -33,8 +33,12 @@ public slots:
 private slots:
     
     void onNoteDoubleClicked(QListWidgetItem* item);
+    
+    void onNoteChanged(int noteId);
 
 private:
+    // Ответ базы, пришедший после новой загрузки списка, отбрасывается.
+    int loadGeneration;
     QListWidget *notesList;
     QPushButton *addButton;
     QPushButton *deleteButton;
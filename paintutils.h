@@ -0,0 +1,14 @@
+#ifndef PAINTUTILS_H
+#define PAINTUTILS_H
+
+#include <QFont>
+
+// Шрифт для рисуемых вручную сеток: размер в пикселях не зависит от DPI, как в таблицах стилей.
+inline QFont pixelFont(QFont font, int pixelSize, bool bold)
+{
+    font.setPixelSize(pixelSize);
+    font.setBold(bold);
+    return font;
+}
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef RECORDS_H
+#define RECORDS_H
+
+#include <QString>
+#include <QDate>
+#include <QTime>
+#include <QDateTime>
+#include <QVariant>
+#include <QSqlQuery>
+#include "recurrence.h"
+#include <tuple>
+#include <utility>
+
+struct TaskRecord
+{
+    int id = -1;
+    QString title;
+    QDate date;
+    QTime time;
+    bool isTimeBound = true;
+    RecurrenceRule recurrence;
+    // У повторения серии — дата и время исходной задачи; у обычной задачи seriesDate недействительна.
+    QDate seriesDate;
+    QTime seriesTime;
+};
+
+struct NoteRecord
+{
+    int id = -1;
+    int userId = -1;
+    QString name;
+    QString content;
+    QDateTime createdAt;
+    QDateTime updatedAt;
+};
+
+struct HabitRecord
+{
+    int id = -1;
+    QString name;
+    QDateTime createdAt;
+};
+
+// Столбцы задач хранят дату юлианским днём, а время — минутой от начала суток.
+template <typename Record>
+struct JulianDayColumn
+{
+    QDate Record::*field;
+};
+
+template <typename Record>
+struct MinuteOfDayColumn
+{
+    QTime Record::*field;
+};
+
+// Порядок полей совпадает с порядком столбцов в SELECT соответствующих запросов Database.
+template <typename Record>
+struct RecordColumns;
+
+template <>
+struct RecordColumns<TaskRecord>
+{
+    static constexpr auto fields = std::make_tuple(&TaskRecord::id, &TaskRecord::title,
+                                                   JulianDayColumn<TaskRecord>{&TaskRecord::date},
+                                                   MinuteOfDayColumn<TaskRecord>{&TaskRecord::time},
+                                                   &TaskRecord::isTimeBound, &TaskRecord::recurrence);
+};
+
+template <>
+struct RecordColumns<NoteRecord>
+{
+    static constexpr auto fields = std::make_tuple(&NoteRecord::id, &NoteRecord::userId,
+                                                   &NoteRecord::name, &NoteRecord::content,
+                                                   &NoteRecord::createdAt, &NoteRecord::updatedAt);
+};
+
+template <>
+struct RecordColumns<HabitRecord>
+{
+    static constexpr auto fields = std::make_tuple(&HabitRecord::id, &HabitRecord::name,
+                                                   &HabitRecord::createdAt);
+};
+
+namespace RecordMapping {
+
+inline void assign(int& field, const QVariant& value) { field = value.toInt(); }
+inline void assign(bool& field, const QVariant& value) { field = value.toBool(); }
+inline void assign(QString& field, const QVariant& value) { field = value.toString(); }
+inline void assign(QDate& field, const QVariant& value) { field = value.toDate(); }
+inline void assign(QTime& field, const QVariant& value) { field = value.toTime(); }
+inline void assign(QDateTime& field, const QVariant& value) { field = value.toDateTime(); }
+inline void assign(RecurrenceRule& field, const QVariant& value) { field = RecurrenceRule::fromCode(value.toULongLong()); }
+
+inline QVariant julianDayValue(const QDate& date)
+{
+    return date.isValid() ? QVariant(date.toJulianDay()) : QVariant();
+}
+
+inline QVariant minuteOfDayValue(const QTime& time)
+{
+    return time.isValid() ? QVariant(time.msecsSinceStartOfDay() / 60000) : QVariant();
+}
+
+template <typename Record, typename Field>
+void readColumn(Record& record, Field Record::*field, const QVariant& value)
+{
+    assign(record.*field, value);
+}
+
+template <typename Record>
+void readColumn(Record& record, JulianDayColumn<Record> column, const QVariant& value)
+{
+    record.*column.field = value.isNull() ? QDate() : QDate::fromJulianDay(value.toLongLong());
+}
+
+template <typename Record>
+void readColumn(Record& record, MinuteOfDayColumn<Record> column, const QVariant& value)
+{
+    int minute = value.toInt();
+    record.*column.field = value.isNull() ? QTime() : QTime(minute / 60, minute % 60);
+}
+
+template <typename Record, std::size_t... Columns>
+void readColumns(const QSqlQuery& query, Record& record, std::index_sequence<Columns...>)
+{
+    constexpr auto& fields = RecordColumns<Record>::fields;
+    (readColumn(record, std::get<Columns>(fields), query.value(int(Columns))), ...);
+}
+
+}
+
+template <typename Record>
+Record readRecord(const QSqlQuery& query)
+{
+    constexpr std::size_t columnCount = std::tuple_size_v<decltype(RecordColumns<Record>::fields)>;
+    Record record;
+    RecordMapping::readColumns(query, record, std::make_index_sequence<columnCount>{});
+    return record;
+}
+
+#endif
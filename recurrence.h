@@ -0,0 +1,283 @@
+#ifndef RECURRENCE_H
+#define RECURRENCE_H
+
+#include <QString>
+#include <QDate>
+#include <QTime>
+#include <QtGlobal>
+#include <QtAlgorithms>
+
+// Правило повторения задачи, упакованное в одно целое (столбец tasks.recurrence_rule):
+// биты 0–3 — частота, 4–11 — интервал, 12–18 — маска дней недели (бит 0 — понедельник),
+// 19–34 — число повторений (0 — без ограничения), 35–62 — юлианский день окончания (0 — без него).
+// Повторения для любого окна [from, to) перечисляются за O(число повторений).
+class RecurrenceRule
+{
+public:
+    enum class Frequency : quint8 {
+        None,
+        Hourly,
+        Daily,
+        Weekly,
+        Monthly
+    };
+
+    constexpr RecurrenceRule() = default;
+
+    constexpr RecurrenceRule(Frequency frequency, int interval, int weekdays = 0,
+                             int count = 0, qint64 untilJulianDay = 0)
+        : ruleFrequency(frequency),
+          ruleInterval(quint8(interval < 1 ? 1 : (interval > 255 ? 255 : interval))),
+          ruleWeekdays(quint8(weekdays & 0x7F)),
+          ruleCount(quint16(count < 0 ? 0 : (count > 0xFFFF ? 0xFFFF : count))),
+          ruleUntil(untilJulianDay < 0 ? 0 : untilJulianDay)
+    {
+    }
+
+    static constexpr RecurrenceRule fromCode(quint64 code)
+    {
+        quint64 frequency = code & 0xF;
+        if (frequency > quint64(Frequency::Monthly)) {
+            return RecurrenceRule();
+        }
+        return RecurrenceRule(Frequency(frequency), int((code >> IntervalShift) & 0xFF),
+                              int((code >> WeekdayShift) & 0x7F), int((code >> CountShift) & 0xFFFF),
+                              qint64((code >> UntilShift) & 0xFFFFFFF));
+    }
+
+    constexpr quint64 code() const
+    {
+        if (ruleFrequency == Frequency::None) {
+            return 0;
+        }
+        return quint64(ruleFrequency)
+               | (quint64(ruleInterval) << IntervalShift)
+               | (quint64(ruleWeekdays) << WeekdayShift)
+               | (quint64(ruleCount) << CountShift)
+               | (quint64(ruleUntil) << UntilShift);
+    }
+
+    // Разбор старого текстового представления, которое TaskDialog сохранял до перехода на коды.
+    static RecurrenceRule fromText(const QString& text);
+
+    QString displayText() const;
+
+    constexpr Frequency frequency() const { return ruleFrequency; }
+
+    constexpr int interval() const { return ruleInterval; }
+
+    constexpr int weekdays() const { return ruleWeekdays; }
+
+    constexpr int count() const { return ruleCount; }
+
+    QDate until() const { return ruleUntil ? QDate::fromJulianDay(ruleUntil) : QDate(); }
+
+    constexpr bool isRecurring() const { return ruleFrequency != Frequency::None; }
+
+    constexpr bool operator==(const RecurrenceRule& other) const { return code() == other.code(); }
+
+    constexpr bool operator!=(const RecurrenceRule& other) const { return code() != other.code(); }
+
+    // Вызывает callback(date, time) для каждого повторения серии, начатой в startDate/startTime,
+    // которое попадает в дни [from, to). Без правила серия состоит из одного исходного дня.
+    // У задач без времени почасовое правило вырождается в ежедневное.
+    template <typename Callback>
+    void forEachOccurrence(const QDate& startDate, const QTime& startTime,
+                           QDate from, QDate to, Callback callback) const
+    {
+        if (ruleUntil && to.toJulianDay() > ruleUntil + 1) {
+            to = QDate::fromJulianDay(ruleUntil + 1);
+        }
+        if (!startDate.isValid() || from >= to) {
+            return;
+        }
+
+        switch (ruleFrequency) {
+        case Frequency::None:
+            if (startDate >= from && startDate < to) {
+                callback(startDate, startTime);
+            }
+            break;
+        case Frequency::Hourly:
+            if (startTime.isValid()) {
+                forEachMinuteStep(startDate, startTime, from, to, 60 * ruleInterval, callback);
+            } else {
+                forEachDayStep(startDate, startTime, from, to, 1, callback);
+            }
+            break;
+        case Frequency::Daily:
+            forEachDayStep(startDate, startTime, from, to, ruleInterval, callback);
+            break;
+        case Frequency::Weekly:
+            if (ruleWeekdays) {
+                forEachWeekday(startDate, startTime, from, to, callback);
+            } else {
+                forEachDayStep(startDate, startTime, from, to, 7 * ruleInterval, callback);
+            }
+            break;
+        case Frequency::Monthly:
+            forEachMonthStep(startDate, startTime, from, to, callback);
+            break;
+        }
+    }
+
+private:
+    static constexpr int IntervalShift = 4;
+    static constexpr int WeekdayShift = 12;
+    static constexpr int CountShift = 19;
+    static constexpr int UntilShift = 35;
+    static constexpr qint64 MinutesPerDay = 24 * 60;
+
+    // Первый шаг k >= 0, при котором start + k * step >= target.
+    static qint64 firstStep(qint64 start, qint64 target, qint64 step)
+    {
+        return target <= start ? 0 : (target - start + step - 1) / step;
+    }
+
+    bool withinCount(qint64 index) const
+    {
+        return ruleCount == 0 || index < ruleCount;
+    }
+
+    template <typename Callback>
+    void forEachMinuteStep(const QDate& startDate, const QTime& startTime,
+                           const QDate& from, const QDate& to, int stepMinutes, Callback& callback) const
+    {
+        qint64 start = startDate.toJulianDay() * MinutesPerDay + startTime.msecsSinceStartOfDay() / 60000;
+        qint64 end = to.toJulianDay() * MinutesPerDay;
+        qint64 k = firstStep(start, from.toJulianDay() * MinutesPerDay, stepMinutes);
+
+        for (qint64 minute = start + k * stepMinutes; minute < end && withinCount(k); minute += stepMinutes, ++k) {
+            int minuteOfDay = int(minute % MinutesPerDay);
+            callback(QDate::fromJulianDay(minute / MinutesPerDay), QTime(minuteOfDay / 60, minuteOfDay % 60));
+        }
+    }
+
+    template <typename Callback>
+    void forEachDayStep(const QDate& startDate, const QTime& startTime,
+                        const QDate& from, const QDate& to, int stepDays, Callback& callback) const
+    {
+        qint64 start = startDate.toJulianDay();
+        qint64 end = to.toJulianDay();
+        qint64 k = firstStep(start, from.toJulianDay(), stepDays);
+
+        for (qint64 day = start + k * stepDays; day < end && withinCount(k); day += stepDays, ++k) {
+            callback(QDate::fromJulianDay(day), startTime);
+        }
+    }
+
+    template <typename Callback>
+    void forEachWeekday(const QDate& startDate, const QTime& startTime,
+                        const QDate& from, const QDate& to, Callback& callback) const
+    {
+        // Недели отсчитываются от понедельника недели startDate; дни маски раньше startDate
+        // в первой неделе не считаются повторениями.
+        qint64 firstMonday = startDate.toJulianDay() - (startDate.dayOfWeek() - 1);
+        qint64 perWeek = qPopulationCount(quint32(ruleWeekdays));
+        qint64 skipped = qPopulationCount(quint32(ruleWeekdays) & ((1u << (startDate.dayOfWeek() - 1)) - 1));
+        qint64 stepDays = 7 * qint64(ruleInterval);
+        qint64 n = firstStep(firstMonday, from.toJulianDay() - 6, stepDays);
+
+        for (qint64 monday = firstMonday + n * stepDays; monday < to.toJulianDay(); monday += stepDays, ++n) {
+            qint64 index = n * perWeek - skipped;
+            for (int weekday = 0; weekday < 7; ++weekday) {
+                if (!(ruleWeekdays & (1 << weekday))) {
+                    continue;
+                }
+                qint64 day = monday + weekday;
+                if (day < startDate.toJulianDay()) {
+                    ++index;
+                    continue;
+                }
+                if (!withinCount(index)) {
+                    return;
+                }
+                if (day >= from.toJulianDay() && day < to.toJulianDay()) {
+                    callback(QDate::fromJulianDay(day), startTime);
+                }
+                ++index;
+            }
+        }
+    }
+
+    template <typename Callback>
+    void forEachMonthStep(const QDate& startDate, const QTime& startTime,
+                          const QDate& from, const QDate& to, Callback& callback) const
+    {
+        // addMonths прижимает 29–31 число к концу короткого месяца, отсчёт всегда идёт от startDate.
+        int monthsToFrom = (from.year() - startDate.year()) * 12 + from.month() - startDate.month();
+
+        for (qint64 k = firstStep(0, monthsToFrom - 1, ruleInterval); withinCount(k); ++k) {
+            QDate date = startDate.addMonths(int(k * ruleInterval));
+            if (date >= to) {
+                break;
+            }
+            if (date >= from) {
+                callback(date, startTime);
+            }
+        }
+    }
+
+    Frequency ruleFrequency = Frequency::None;
+    quint8 ruleInterval = 1;
+    quint8 ruleWeekdays = 0;
+    quint16 ruleCount = 0;
+    qint64 ruleUntil = 0;
+};
+
+// Варианты, которые предлагает TaskDialog, и их подписи.
+struct RecurrencePreset
+{
+    RecurrenceRule rule;
+    const char *text;
+};
+
+inline constexpr RecurrencePreset recurrencePresets[] = {
+    {RecurrenceRule(RecurrenceRule::Frequency::Hourly, 1), "Раз в час"},
+    {RecurrenceRule(RecurrenceRule::Frequency::Hourly, 2), "Раз в 2 часа"},
+    {RecurrenceRule(RecurrenceRule::Frequency::Daily, 1), "Раз в сутки"},
+    {RecurrenceRule(RecurrenceRule::Frequency::Weekly, 1), "Раз в неделю"},
+    {RecurrenceRule(RecurrenceRule::Frequency::Monthly, 1), "Раз в месяц"}
+};
+
+static_assert(RecurrenceRule::fromCode(recurrencePresets[1].rule.code()) == recurrencePresets[1].rule,
+              "код правила повторения должен однозначно разбираться обратно");
+
+inline RecurrenceRule RecurrenceRule::fromText(const QString& text)
+{
+    for (const RecurrencePreset& preset : recurrencePresets) {
+        if (text == QString::fromUtf8(preset.text)) {
+            return preset.rule;
+        }
+    }
+    return RecurrenceRule();
+}
+
+inline QString RecurrenceRule::displayText() const
+{
+    if (!isRecurring()) {
+        return QString();
+    }
+
+    for (const RecurrencePreset& preset : recurrencePresets) {
+        if (preset.rule == *this) {
+            return QString::fromUtf8(preset.text);
+        }
+    }
+
+    switch (ruleFrequency) {
+    case Frequency::Hourly:
+        return QString("Раз в %1 ч").arg(ruleInterval);
+    case Frequency::Daily:
+        return QString("Раз в %1 дн").arg(ruleInterval);
+    case Frequency::Weekly:
+        return QString("Раз в %1 нед").arg(ruleInterval);
+    case Frequency::Monthly:
+        return QString("Раз в %1 мес").arg(ruleInterval);
+    case Frequency::None:
+        break;
+    }
+    return QString();
+}
+
+#endif
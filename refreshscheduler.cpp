@@ -0,0 +1,57 @@
+#include "refreshscheduler.h"
+
+RefreshScheduler::RefreshScheduler(QStackedWidget *stack, QObject *parent)
+    : QObject(parent), stack(stack), flushScheduled(false), refreshes(0)
+{
+    connect(stack, &QStackedWidget::currentChanged, this, &RefreshScheduler::scheduleFlush);
+}
+
+void RefreshScheduler::addView(QWidget *view, std::function<void()> refresh)
+{
+    views[view].refresh = std::move(refresh);
+}
+
+void RefreshScheduler::requestRefresh(QWidget *view)
+{
+    auto it = views.find(view);
+    if (it == views.end()) {
+        return;
+    }
+    
+    it->dirty = true;
+    if (view == stack->currentWidget()) {
+        scheduleFlush();
+    }
+}
+
+void RefreshScheduler::requestRefreshAll()
+{
+    for (View& view : views) {
+        view.dirty = true;
+    }
+    scheduleFlush();
+}
+
+void RefreshScheduler::scheduleFlush()
+{
+    if (flushScheduled) {
+        return;
+    }
+    
+    flushScheduled = true;
+    QMetaObject::invokeMethod(this, &RefreshScheduler::flush, Qt::QueuedConnection);
+}
+
+void RefreshScheduler::flush()
+{
+    flushScheduled = false;
+    
+    auto it = views.find(stack->currentWidget());
+    if (it == views.end() || !it->dirty) {
+        return;
+    }
+    
+    it->dirty = false;
+    ++refreshes;
+    it->refresh();
+}
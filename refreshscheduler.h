@@ -0,0 +1,45 @@
+#ifndef REFRESHSCHEDULER_H
+#define REFRESHSCHEDULER_H
+
+#include <QObject>
+#include <QStackedWidget>
+#include <QHash>
+#include <functional>
+
+// Отложенная перестройка представлений из стека MainWindow. Запрос только помечает представление
+// устаревшим; перестройка выполняется не чаще раза за итерацию цикла событий и лишь для
+// представления, которое сейчас показано. Остальные перестраиваются, когда их покажут.
+class RefreshScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RefreshScheduler(QStackedWidget *stack, QObject *parent = nullptr);
+
+    void addView(QWidget *view, std::function<void()> refresh);
+
+    void requestRefresh(QWidget *view);
+
+    // Например, после входа или выхода пользователя.
+    void requestRefreshAll();
+
+    int refreshCount() const { return refreshes; }
+
+private slots:
+    void flush();
+
+private:
+    struct View {
+        std::function<void()> refresh;
+        bool dirty = false;
+    };
+
+    void scheduleFlush();
+
+    QStackedWidget *stack;
+    QHash<QWidget*, View> views;
+    bool flushScheduled;
+    int refreshes;
+};
+
+#endif
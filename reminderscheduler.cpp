@@ -0,0 +1,284 @@
+#include "reminderscheduler.h"
+#include "database.h"
+#include "databaseworker.h"
+#include <QDateTime>
+#include <QSettings>
+#include <QDebug>
+#include <algorithm>
+#include <functional>
+
+ReminderScheduler::ReminderScheduler(QObject *parent)
+    : QObject(parent), lastWallMs(0), enabled(false), loadGeneration(0), nextVersion(0)
+{
+    timer = new QTimer(this);
+    timer->setSingleShot(true);
+    timer->setTimerType(Qt::PreciseTimer);
+    connect(timer, &QTimer::timeout, this, &ReminderScheduler::onTimeout);
+}
+
+void ReminderScheduler::setEnabled(bool value)
+{
+    enabled = value;
+    if (!enabled) {
+        // Пока напоминания выключены, ничего не считается пропущенным.
+        QSettings settings;
+        settings.remove("reminders/lastSeen");
+    }
+    reload();
+}
+
+void ReminderScheduler::reload()
+{
+    int generation = ++loadGeneration;
+    clear();
+    
+    Database& db = Database::instance();
+    if (!enabled || !db.isLoggedIn()) {
+        windowStart = QDate();
+        timer->stop();
+        return;
+    }
+    
+    QDateTime now = QDateTime::currentDateTime();
+    windowStart = now.date();
+    lastWallMs = now.toMSecsSinceEpoch();
+    clock.start();
+    
+    qint64 expired = lastWallMs - LateGraceMs;
+    for (auto it = delivered.begin(); it != delivered.end();) {
+        it = it->second < expired ? delivered.erase(it) : std::next(it);
+    }
+    
+    QDateTime from = catchUpStart(now);
+    QDateTime to(windowStart.addDays(HorizonDays), QTime(0, 0));
+    rememberLastSeen(now);
+    
+    int userId = db.getCurrentUserId();
+    DatabaseWorker::instance().run([userId, from, to](Database& db) {
+        return db.getPendingReminders(userId, from, to);
+    }).then(this, [this, generation](const std::vector<TaskRecord>& tasks) {
+        if (generation != loadGeneration) {
+            return;
+        }
+        
+        applyWindow(tasks);
+        arm();
+    });
+    
+    arm();
+}
+
+QDateTime ReminderScheduler::catchUpStart(const QDateTime& now) const
+{
+    QDateTime from = now.addMSecs(-LateGraceMs);
+    
+    QSettings settings;
+    QDateTime lastSeen = settings.value("reminders/lastSeen").toDateTime();
+    if (lastSeen.isValid() && lastSeen < from) {
+        from = qMax(lastSeen, now.addDays(-HorizonDays));
+    }
+    
+    return from;
+}
+
+void ReminderScheduler::rememberLastSeen(const QDateTime& now)
+{
+    QSettings settings;
+    settings.setValue("reminders/lastSeen", now);
+}
+
+void ReminderScheduler::applyWindow(const std::vector<TaskRecord>& tasks)
+{
+    qint64 expired = QDateTime::currentMSecsSinceEpoch() - LateGraceMs;
+    QStringList missedTitles;
+    QList<QPair<int, QDateTime>> missed;
+    
+    for (const TaskRecord& task : tasks) {
+        QDateTime dueAt(task.date, task.time);
+        Reminder reminder(task.id, dueAt.toMSecsSinceEpoch());
+        if (reminder.second >= expired) {
+            schedule(task);
+            continue;
+        }
+        
+        if (!delivered.contains(reminder)) {
+            missedTitles << task.title;
+            missed << qMakePair(task.id, dueAt);
+            delivered.insert(reminder);
+        }
+    }
+    
+    compactHeap();
+    
+    if (missed.isEmpty()) {
+        return;
+    }
+    
+    DatabaseWorker::instance().run([missed](Database& db) {
+        db.beginBatch();
+        for (const QPair<int, QDateTime>& reminder : missed) {
+            db.recordReminderDelivery(reminder.first, reminder.second);
+        }
+        db.commitBatch();
+    });
+    
+    emit remindersMissed(missedTitles);
+}
+
+void ReminderScheduler::reloadDay(const QDate& date)
+{
+    Database& db = Database::instance();
+    if (!enabled || !db.isLoggedIn() || !windowStart.isValid()
+        || date < windowStart || date >= windowStart.addDays(HorizonDays)) {
+        return;
+    }
+    
+    int generation = loadGeneration;
+    int userId = db.getCurrentUserId();
+    QDateTime from(date, QTime(0, 0));
+    QDateTime to(date.addDays(1), QTime(0, 0));
+    DatabaseWorker::instance().run([userId, from, to](Database& db) {
+        return db.getPendingReminders(userId, from, to);
+    }).then(this, [this, generation, date](const std::vector<TaskRecord>& tasks) {
+        if (generation != loadGeneration) {
+            return;
+        }
+        
+        applyDay(date, tasks);
+        arm();
+    });
+}
+
+void ReminderScheduler::clear()
+{
+    scheduled.clear();
+    remindersByDay.clear();
+    heap.clear();
+}
+
+void ReminderScheduler::applyDay(const QDate& date, const std::vector<TaskRecord>& tasks)
+{
+    const QSet<Reminder> previous = remindersByDay.take(date);
+    for (const Reminder& reminder : previous) {
+        scheduled.remove(reminder);
+    }
+    
+    for (const TaskRecord& task : tasks) {
+        schedule(task);
+    }
+    
+    compactHeap();
+}
+
+// Перенесённая задача снимается с прежнего дня через applyDay: об изменении сообщается
+// и старый, и новый день, а изменение серии перезагружает всё окно.
+void ReminderScheduler::schedule(const TaskRecord& task)
+{
+    if (!task.isTimeBound || !task.time.isValid()) {
+        return;
+    }
+    
+    qint64 due = QDateTime(task.date, task.time).toMSecsSinceEpoch();
+    if (due < QDateTime::currentMSecsSinceEpoch() - LateGraceMs) {
+        return;
+    }
+    
+    Reminder reminder(task.id, due);
+    if (delivered.contains(reminder)) {
+        return;
+    }
+    
+    quint64 version = ++nextVersion;
+    scheduled.insert(reminder, {task.date, task.title, version});
+    remindersByDay[task.date].insert(reminder);
+    
+    heap.push_back({due, task.id, version});
+    std::push_heap(heap.begin(), heap.end(), std::greater<HeapEntry>());
+}
+
+bool ReminderScheduler::isCurrent(const HeapEntry& entry) const
+{
+    auto it = scheduled.constFind(entry.reminder());
+    return it != scheduled.cend() && it->version == entry.version;
+}
+
+void ReminderScheduler::compactHeap()
+{
+    // Удалённые и перенесённые задачи остаются в куче до извлечения; чистим, когда их набирается много.
+    if (heap.size() <= 2 * size_t(scheduled.size()) + 64) {
+        return;
+    }
+    
+    heap.erase(std::remove_if(heap.begin(), heap.end(),
+                              [this](const HeapEntry& entry) { return !isCurrent(entry); }),
+               heap.end());
+    std::make_heap(heap.begin(), heap.end(), std::greater<HeapEntry>());
+}
+
+void ReminderScheduler::arm()
+{
+    while (!heap.empty() && !isCurrent(heap.front())) {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<HeapEntry>());
+        heap.pop_back();
+    }
+    
+    if (!windowStart.isValid()) {
+        timer->stop();
+        return;
+    }
+    
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 next = QDateTime(QDate::currentDate().addDays(1), QTime(0, 0)).toMSecsSinceEpoch();
+    if (!heap.empty()) {
+        next = qMin(next, heap.front().due);
+    }
+    
+    timer->start(int(qBound<qint64>(0, next - now, MaxSleepMs)));
+}
+
+void ReminderScheduler::onTimeout()
+{
+    // Монотонные часы не идут во время сна системы и не замечают перевод времени,
+    // поэтому расхождение с настенными часами означает, что окно нужно пересчитать.
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 drift = (now - lastWallMs) - clock.restart();
+    lastWallMs = now;
+    
+    if (qAbs(drift) > ClockJumpToleranceMs) {
+        qDebug() << "Системные часы сдвинулись на" << drift / 1000 << "с, перечитываем напоминания";
+        reload();
+        return;
+    }
+    
+    if (QDate::currentDate() != windowStart) {
+        reload();
+        return;
+    }
+    
+    rememberLastSeen(QDateTime::fromMSecsSinceEpoch(now));
+    
+    while (!heap.empty() && heap.front().due <= now) {
+        HeapEntry entry = heap.front();
+        std::pop_heap(heap.begin(), heap.end(), std::greater<HeapEntry>());
+        heap.pop_back();
+        
+        if (!isCurrent(entry)) {
+            continue;
+        }
+        
+        Reminder reminder = entry.reminder();
+        Scheduled item = scheduled.take(reminder);
+        remindersByDay[item.date].remove(reminder);
+        delivered.insert(reminder);
+        
+        int taskId = entry.taskId;
+        QDateTime dueAt = QDateTime::fromMSecsSinceEpoch(entry.due);
+        DatabaseWorker::instance().run([taskId, dueAt](Database& db) {
+            return db.recordReminderDelivery(taskId, dueAt);
+        });
+        
+        emit reminderDue(entry.taskId, item.title);
+    }
+    
+    arm();
+}
@@ -0,0 +1,95 @@
+#ifndef REMINDERSCHEDULER_H
+#define REMINDERSCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QDate>
+#include <QHash>
+#include <QSet>
+#include <QPair>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <vector>
+#include "records.h"
+
+// Напоминания о задачах с привязкой ко времени на ближайшие HorizonDays дней.
+// Сроки лежат в min-куче, и единственный таймер взводится на ближайший из них (но не дальше
+// MaxSleepMs, чтобы заметить сон системы или перевод часов). Доставленные напоминания
+// записываются в reminder_deliveries; пропущенные за время простоя приходят одной сводкой.
+// У повторяющейся задачи своё напоминание на каждое повторение, поэтому напоминание
+// определяется парой (задача, срок), а не одной задачей.
+class ReminderScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int HorizonDays = 7;
+
+    explicit ReminderScheduler(QObject *parent = nullptr);
+
+    void setEnabled(bool enabled);
+
+    // Полная перезагрузка окна, например после входа или выхода пользователя.
+    void reload();
+
+    // Перечитывает задачи одного дня после создания, изменения или удаления.
+    void reloadDay(const QDate& date);
+
+    int pendingCount() const { return int(scheduled.size()); }
+
+signals:
+    void reminderDue(int taskId, const QString& title);
+    void remindersMissed(const QStringList& titles);
+
+private slots:
+    void onTimeout();
+
+private:
+    // Задача, срок которой прошёл не более минуты назад, ещё считается предстоящей.
+    static constexpr qint64 LateGraceMs = 60 * 1000;
+    static constexpr qint64 MaxSleepMs = 5 * 60 * 1000;
+    static constexpr qint64 ClockJumpToleranceMs = 5 * 1000;
+
+    // Задача и срок напоминания в миллисекундах от эпохи.
+    using Reminder = QPair<int, qint64>;
+
+    struct Scheduled {
+        QDate date;
+        QString title;
+        quint64 version;
+    };
+
+    struct HeapEntry {
+        qint64 due;
+        int taskId;
+        quint64 version;
+
+        Reminder reminder() const { return Reminder(taskId, due); }
+
+        bool operator>(const HeapEntry& other) const { return due > other.due; }
+    };
+
+    QDateTime catchUpStart(const QDateTime& now) const;
+    void rememberLastSeen(const QDateTime& now);
+    void applyWindow(const std::vector<TaskRecord>& tasks);
+    void clear();
+    void applyDay(const QDate& date, const std::vector<TaskRecord>& tasks);
+    void schedule(const TaskRecord& task);
+    bool isCurrent(const HeapEntry& entry) const;
+    void compactHeap();
+    void arm();
+
+    QTimer *timer;
+    QElapsedTimer clock;
+    qint64 lastWallMs;
+    bool enabled;
+    QDate windowStart;
+    int loadGeneration;
+    quint64 nextVersion;
+    QHash<Reminder, Scheduled> scheduled;
+    QHash<QDate, QSet<Reminder>> remindersByDay;
+    QSet<Reminder> delivered;
+    std::vector<HeapEntry> heap;
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef STORAGEPROFILE_H
+#define STORAGEPROFILE_H
+
+#include <QString>
+#include <QStringList>
+#include <QSettings>
+#include <QDebug>
+
+// Параметры SQLite, применяемые к каждому соединению при открытии.
+// Профиль читается из группы "storage" в QSettings: "profile" выбирает набор значений
+// по умолчанию ("desktop" или "bulkImport"), остальные ключи переопределяют отдельные параметры.
+struct StorageProfile
+{
+    QString journalMode = "WAL";
+    QString synchronous = "NORMAL";
+    int cacheSize = -16000;
+    qint64 mmapSize = 256 * 1024 * 1024;
+    QString tempStore = "MEMORY";
+    int busyTimeout = 5000;
+
+    static StorageProfile desktop()
+    {
+        return StorageProfile();
+    }
+
+    // Массовый импорт: надёжность после сбоя питания в обмен на скорость записи.
+    static StorageProfile bulkImport()
+    {
+        StorageProfile profile;
+        profile.synchronous = "OFF";
+        profile.cacheSize = -65536;
+        profile.busyTimeout = 30000;
+        return profile;
+    }
+
+    static StorageProfile fromSettings(QSettings& settings)
+    {
+        settings.beginGroup("storage");
+
+        StorageProfile profile = settings.value("profile", "desktop").toString() == "bulkImport"
+                                 ? bulkImport() : desktop();
+
+        profile.journalMode = checkedValue(settings, "journalMode", profile.journalMode,
+                                           {"DELETE", "TRUNCATE", "PERSIST", "MEMORY", "WAL", "OFF"});
+        profile.synchronous = checkedValue(settings, "synchronous", profile.synchronous,
+                                           {"OFF", "NORMAL", "FULL", "EXTRA"});
+        profile.tempStore = checkedValue(settings, "tempStore", profile.tempStore,
+                                         {"DEFAULT", "FILE", "MEMORY"});
+        profile.cacheSize = settings.value("cacheSize", profile.cacheSize).toInt();
+        profile.mmapSize = qMax(settings.value("mmapSize", profile.mmapSize).toLongLong(), qint64(0));
+        profile.busyTimeout = qMax(settings.value("busyTimeout", profile.busyTimeout).toInt(), 0);
+
+        settings.endGroup();
+        return profile;
+    }
+
+    QStringList pragmas() const
+    {
+        return {
+            QString("PRAGMA journal_mode=%1").arg(journalMode),
+            QString("PRAGMA synchronous=%1").arg(synchronous),
+            QString("PRAGMA cache_size=%1").arg(cacheSize),
+            QString("PRAGMA mmap_size=%1").arg(mmapSize),
+            QString("PRAGMA temp_store=%1").arg(tempStore),
+            QString("PRAGMA busy_timeout=%1").arg(busyTimeout)
+        };
+    }
+
+private:
+    // Значения подставляются в текст PRAGMA, поэтому принимаются только известные ключевые слова.
+    static QString checkedValue(QSettings& settings, const QString& key, const QString& fallback,
+                                const QStringList& allowed)
+    {
+        QString value = settings.value(key, fallback).toString().toUpper();
+        if (!allowed.contains(value)) {
+            qDebug() << "Недопустимое значение параметра хранилища" << key << ":" << value;
+            return fallback;
+        }
+        return value;
+    }
+};
+
+#endif
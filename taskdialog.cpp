@@ -30,7 +30,7 @@ TaskDialog::TaskDialog(const QDate& defaultDate, QWidget *parent)
 }
 
 TaskDialog::TaskDialog(int taskId, const QString& title, const QDateTime& dateTime,
-                       bool isTimeBound, const QString& recurrence, QWidget *parent)
+                       bool isTimeBound, const RecurrenceRule& recurrence, QWidget *parent)
     : QDialog(parent), defaultDate(dateTime.date())
 {
     Q_UNUSED(taskId);
@@ -40,10 +40,10 @@ TaskDialog::TaskDialog(int taskId, const QString& title, const QDateTime& dateTi
     timeBoundCheckBox->setChecked(!isTimeBound);
     onTimeBoundChanged();
     
-    if (!recurrence.isEmpty()) {
+    if (recurrence.isRecurring()) {
         recurringCheckBox->setChecked(true);
         onRecurringChanged();
-        int index = recurrenceCombo->findText(recurrence);
+        int index = recurrenceCombo->findData(qulonglong(recurrence.code()));
         if (index >= 0) {
             recurrenceCombo->setCurrentIndex(index);
         }
@@ -80,7 +80,9 @@ void TaskDialog::setupUI()
     layout->addWidget(recurringCheckBox);
     
     recurrenceCombo = new QComboBox;
-    recurrenceCombo->addItems({"Раз в час", "Раз в 2 часа", "Раз в сутки", "Раз в неделю", "Раз в месяц"});
+    for (const RecurrencePreset& preset : recurrencePresets) {
+        recurrenceCombo->addItem(QString::fromUtf8(preset.text), qulonglong(preset.rule.code()));
+    }
     recurrenceCombo->setEnabled(false);
     layout->addWidget(recurrenceCombo);
     
@@ -173,10 +175,10 @@ QDateTime TaskDialog::getDateTime() const
     }
 }
 
-QString TaskDialog::getRecurrence() const
+RecurrenceRule TaskDialog::getRecurrence() const
 {
     if (recurringCheckBox->isChecked()) {
-        return recurrenceCombo->currentText();
+        return RecurrenceRule::fromCode(recurrenceCombo->currentData().toULongLong());
     }
-    return QString();
+    return RecurrenceRule();
 }
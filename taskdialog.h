@@ -10,6 +10,7 @@
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QLabel>
+#include "recurrence.h"
 
 class TaskDialog : public QDialog
 {
@@ -20,7 +21,7 @@ public:
     explicit TaskDialog(const QDate& defaultDate, QWidget *parent = nullptr);
     
     explicit TaskDialog(int taskId, const QString& title, const QDateTime& dateTime,
-                       bool isTimeBound, const QString& recurrence, QWidget *parent = nullptr);
+                       bool isTimeBound, const RecurrenceRule& recurrence, QWidget *parent = nullptr);
     
     QString getTitle() const { return titleEdit->text(); }
     
@@ -28,7 +29,7 @@ public:
     
     bool isTimeBound() const { return !timeBoundCheckBox->isChecked(); }
     
-    QString getRecurrence() const;
+    RecurrenceRule getRecurrence() const;
 
 private slots:
     void onTimeBoundChanged();
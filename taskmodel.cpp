@@ -0,0 +1,265 @@
+#include "taskmodel.h"
+#include "database.h"
+#include "taskrepository.h"
+
+TaskModel::TaskModel(QObject *parent)
+    : QAbstractItemModel(parent), loadGeneration(0)
+{
+    TaskRepository& repository = TaskRepository::instance();
+    connect(&repository, &TaskRepository::tasksChanged, this, &TaskModel::onTasksChanged);
+    connect(&repository, &TaskRepository::taskSeriesChanged, this, &TaskModel::onTaskSeriesChanged);
+}
+
+void TaskModel::setRange(const QDate& from, const QDate& to)
+{
+    int generation = ++loadGeneration;
+    
+    if (!Database::instance().isLoggedIn()) {
+        pendingFrom = QDate();
+        pendingTo = QDate();
+        beginResetModel();
+        rangeFrom = from;
+        rangeTo = to;
+        days.assign(size_t(from.daysTo(to) + 1), {});
+        rowsById.clear();
+        endResetModel();
+        return;
+    }
+    
+    pendingFrom = from;
+    pendingTo = to;
+    TaskRepository::instance().tasksForRange(from, to).then(this, [this, generation, from, to](const QHash<QDate, std::vector<TaskRecord>>& tasksByDate) {
+        if (generation != loadGeneration) {
+            return;
+        }
+        
+        pendingFrom = QDate();
+        pendingTo = QDate();
+        beginResetModel();
+        rangeFrom = from;
+        rangeTo = to;
+        days.assign(size_t(from.daysTo(to) + 1), {});
+        for (int day = 0; day < int(days.size()); ++day) {
+            days[day] = tasksByDate.value(from.addDays(day));
+        }
+        rebuildIndex();
+        endResetModel();
+    });
+}
+
+QModelIndex TaskModel::dayIndex(const QDate& date) const
+{
+    if (!date.isValid() || days.empty() || date < rangeFrom || date > rangeTo) {
+        return QModelIndex();
+    }
+    return createIndex(int(rangeFrom.daysTo(date)), 0, DayId);
+}
+
+QModelIndex TaskModel::taskIndex(int taskId) const
+{
+    auto it = rowsById.constFind(taskId);
+    if (it == rowsById.constEnd()) {
+        return QModelIndex();
+    }
+    return createIndex(it->second, 0, quintptr(it->first + 1));
+}
+
+bool TaskModel::findTask(int taskId, TaskRecord& task) const
+{
+    auto it = rowsById.constFind(taskId);
+    if (it == rowsById.constEnd()) {
+        return false;
+    }
+    task = days[it->first][it->second];
+    return true;
+}
+
+QModelIndex TaskModel::index(int row, int column, const QModelIndex& parent) const
+{
+    if (column != 0 || row < 0 || row >= rowCount(parent)) {
+        return QModelIndex();
+    }
+    
+    if (!parent.isValid()) {
+        return createIndex(row, column, DayId);
+    }
+    return createIndex(row, column, quintptr(parent.row() + 1));
+}
+
+QModelIndex TaskModel::parent(const QModelIndex& child) const
+{
+    if (!child.isValid() || child.internalId() == DayId) {
+        return QModelIndex();
+    }
+    return createIndex(int(child.internalId() - 1), 0, DayId);
+}
+
+int TaskModel::rowCount(const QModelIndex& parent) const
+{
+    if (!parent.isValid()) {
+        return int(days.size());
+    }
+    if (parent.column() != 0 || parent.internalId() != DayId) {
+        return 0;
+    }
+    return int(days[parent.row()].size());
+}
+
+int TaskModel::columnCount(const QModelIndex& parent) const
+{
+    Q_UNUSED(parent);
+    return 1;
+}
+
+QVariant TaskModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+    
+    if (index.internalId() == DayId) {
+        QDate date = rangeFrom.addDays(index.row());
+        if (role == DateRole) {
+            return date;
+        }
+        if (role == Qt::DisplayRole) {
+            return date.day();
+        }
+        return QVariant();
+    }
+    
+    const TaskRecord& task = days[index.internalId() - 1][index.row()];
+    switch (role) {
+    case Qt::DisplayRole:
+        if (task.isTimeBound && task.time.isValid()) {
+            return task.time.toString("HH:mm") + " " + task.title;
+        }
+        return task.title;
+    case Qt::ToolTipRole:
+    case TitleRole:
+        return task.title;
+    case TaskIdRole:
+        return task.id;
+    case DateRole:
+        return task.date;
+    case TimeRole:
+        return task.time;
+    case TimeBoundRole:
+        return task.isTimeBound;
+    case RecurrenceRole:
+        return qulonglong(task.recurrence.code());
+    case SeriesDateRole:
+        return task.seriesDate;
+    case SeriesTimeRole:
+        return task.seriesTime;
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> TaskModel::roleNames() const
+{
+    QHash<int, QByteArray> names = QAbstractItemModel::roleNames();
+    names.insert(TaskIdRole, "taskId");
+    names.insert(TitleRole, "title");
+    names.insert(DateRole, "date");
+    names.insert(TimeRole, "time");
+    names.insert(TimeBoundRole, "timeBound");
+    names.insert(RecurrenceRole, "recurrence");
+    names.insert(SeriesDateRole, "seriesDate");
+    names.insert(SeriesTimeRole, "seriesTime");
+    return names;
+}
+
+void TaskModel::onTasksChanged(const QDate& date)
+{
+    reloadDays(date, date);
+}
+
+void TaskModel::onTaskSeriesChanged(const QDate& from)
+{
+    reloadDays(from, qMax(rangeTo, pendingTo));
+}
+
+// Если изменение задело период, загрузка которого ещё идёт, она могла прочитать старые данные
+// и перезапускается; показанный период всё равно будет ею заменён.
+void TaskModel::reloadDays(const QDate& from, const QDate& to)
+{
+    if (!Database::instance().isLoggedIn()) {
+        return;
+    }
+    
+    if (pendingFrom.isValid() && from <= pendingTo && to >= pendingFrom) {
+        setRange(pendingFrom, pendingTo);
+        return;
+    }
+    
+    if (days.empty()) {
+        return;
+    }
+    
+    QDate first = qMax(from, rangeFrom);
+    QDate last = qMin(to, rangeTo);
+    if (first > last) {
+        return;
+    }
+    
+    int generation = loadGeneration;
+    QDate loadedFrom = rangeFrom;
+    QDate loadedTo = rangeTo;
+    TaskRepository::instance().tasksForRange(first, last).then(this, [this, generation, loadedFrom, loadedTo, first, last](const QHash<QDate, std::vector<TaskRecord>>& tasksByDate) {
+        // Период мог смениться загрузкой, начатой раньше этой, и номера дней уже другие.
+        if (generation != loadGeneration || !hasRange(loadedFrom, loadedTo)) {
+            return;
+        }
+        
+        for (QDate date = first; date <= last; date = date.addDays(1)) {
+            replaceDay(int(rangeFrom.daysTo(date)), tasksByDate.value(date));
+        }
+        rebuildIndex();
+        
+        for (QDate date = first; date <= last; date = date.addDays(1)) {
+            emit dayChanged(date);
+        }
+    });
+}
+
+// Равное число строк обновляется на месте одним dataChanged, иначе строки дня заменяются целиком.
+void TaskModel::replaceDay(int day, std::vector<TaskRecord> tasks)
+{
+    std::vector<TaskRecord>& current = days[day];
+    QModelIndex parent = createIndex(day, 0, DayId);
+    int oldCount = int(current.size());
+    int newCount = int(tasks.size());
+    
+    if (oldCount == newCount) {
+        current = std::move(tasks);
+        if (newCount > 0) {
+            emit dataChanged(index(0, 0, parent), index(newCount - 1, 0, parent));
+        }
+        return;
+    }
+    
+    if (oldCount > 0) {
+        beginRemoveRows(parent, 0, oldCount - 1);
+        current.clear();
+        endRemoveRows();
+    }
+    if (newCount > 0) {
+        beginInsertRows(parent, 0, newCount - 1);
+        current = std::move(tasks);
+        endInsertRows();
+    }
+}
+
+void TaskModel::rebuildIndex()
+{
+    rowsById.clear();
+    for (int day = 0; day < int(days.size()); ++day) {
+        for (int row = 0; row < int(days[day].size()); ++row) {
+            int id = days[day][row].id;
+            if (!rowsById.contains(id)) {
+                rowsById.insert(id, qMakePair(day, row));
+            }
+        }
+    }
+}
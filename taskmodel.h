@@ -0,0 +1,89 @@
+#ifndef TASKMODEL_H
+#define TASKMODEL_H
+
+#include <QAbstractItemModel>
+#include <QDate>
+#include <QHash>
+#include <QPair>
+#include <vector>
+#include "records.h"
+
+// Общая модель задач за период [rangeStart(), rangeEnd()] для DayView, WeekView и MonthView.
+// Строки верхнего уровня — дни периода по порядку, их дочерние строки — задачи дня.
+// Период задаёт показанное представление; данные приходят из TaskRepository, а изменения
+// отдельных дней приходят точечными rowsRemoved/rowsInserted/dataChanged под строкой дня
+// и затем сигналом dayChanged.
+class TaskModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    enum Role {
+        TaskIdRole = Qt::UserRole + 1,
+        TitleRole,
+        DateRole,
+        TimeRole,
+        TimeBoundRole,
+        RecurrenceRole,
+        SeriesDateRole,
+        SeriesTimeRole
+    };
+
+    explicit TaskModel(QObject *parent = nullptr);
+
+    // Загружает задачи дней [from, to]. Когда данные готовы, модель сбрасывается (modelReset);
+    // до этого она продолжает отдавать прежний период.
+    void setRange(const QDate& from, const QDate& to);
+
+    QDate rangeStart() const { return rangeFrom; }
+
+    QDate rangeEnd() const { return rangeTo; }
+
+    bool hasRange(const QDate& from, const QDate& to) const { return rangeFrom == from && rangeTo == to; }
+
+    QModelIndex dayIndex(const QDate& date) const;
+
+    // Поиск по id за O(1). У повторяющейся задачи находится первое повторение в периоде.
+    QModelIndex taskIndex(int taskId) const;
+
+    bool findTask(int taskId, TaskRecord& task) const;
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
+
+    QModelIndex parent(const QModelIndex& child) const override;
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    QHash<int, QByteArray> roleNames() const override;
+
+signals:
+    // Задачи дня date заменены на месте; смена всего периода приходит через modelReset.
+    // Модель общая, поэтому день может оказаться и в периоде скрытого представления.
+    void dayChanged(const QDate& date);
+
+private:
+    // internalId строки задачи — номер её дня плюс один; у строки дня он равен нулю.
+    static constexpr quintptr DayId = 0;
+
+    void onTasksChanged(const QDate& date);
+    void onTaskSeriesChanged(const QDate& from);
+    void reloadDays(const QDate& from, const QDate& to);
+    void replaceDay(int day, std::vector<TaskRecord> tasks);
+    void rebuildIndex();
+
+    QDate rangeFrom;
+    QDate rangeTo;
+    // Период, загрузка которого ещё идёт; недействителен, если загрузки нет.
+    QDate pendingFrom;
+    QDate pendingTo;
+    std::vector<std::vector<TaskRecord>> days;
+    // id задачи → (день, строка).
+    QHash<int, QPair<int, int>> rowsById;
+    int loadGeneration;
+};
+
+#endif
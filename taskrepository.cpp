@@ -0,0 +1,260 @@
+#include "taskrepository.h"
+#include "database.h"
+#include "databaseworker.h"
+#include "databasenotifier.h"
+#include <QPromise>
+#include <optional>
+
+template <typename T>
+static QFuture<T> readyFuture(const T& value)
+{
+    QPromise<T> promise;
+    QFuture<T> future = promise.future();
+    promise.start();
+    promise.addResult(value);
+    promise.finish();
+    return future;
+}
+
+TaskRepository& TaskRepository::instance()
+{
+    static TaskRepository instance;
+    return instance;
+}
+
+TaskRepository::TaskRepository()
+    : days(MaxCachedTasks), cachedUserId(-1), epoch(0), hits(0), misses(0)
+{
+    DatabaseNotifier& notifier = DatabaseNotifier::instance();
+    connect(&notifier, &DatabaseNotifier::tasksChanged, this, &TaskRepository::onTasksChanged);
+    connect(&notifier, &DatabaseNotifier::taskSeriesChanged, this, &TaskRepository::onTaskSeriesChanged);
+}
+
+QFuture<QHash<QDate, std::vector<TaskRecord>>> TaskRepository::tasksForRange(const QDate& from, const QDate& to)
+{
+    checkUser();
+    
+    TasksByDate tasksByDate;
+    if (lookup(from, to, tasksByDate)) {
+        ++hits;
+        return readyFuture(tasksByDate);
+    }
+    ++misses;
+    
+    return load(from, to);
+}
+
+QFuture<std::vector<TaskRecord>> TaskRepository::tasksForDay(const QDate& date)
+{
+    return tasksForRange(date, date).then([date](const TasksByDate& tasksByDate) {
+        return tasksByDate.value(date);
+    });
+}
+
+void TaskRepository::prefetch(const QDate& from, const QDate& to)
+{
+    checkUser();
+    
+    if (!isCached(from, to)) {
+        load(from, to);
+    }
+}
+
+QFuture<QHash<QDate, std::vector<TaskRecord>>> TaskRepository::load(const QDate& from, const QDate& to)
+{
+    QPair<QDate, QDate> key(from, to);
+    auto it = pending.constFind(key);
+    if (it != pending.constEnd()) {
+        return it.value();
+    }
+    
+    // Неудачная выборка в кэш не попадает: иначе дни показывались бы пустыми до следующего сброса.
+    int userId = cachedUserId;
+    quint64 requestEpoch = epoch;
+    QFuture<TasksByDate> future = DatabaseWorker::instance().run([userId, from, to](Database& db) {
+        bool ok = false;
+        TasksByDate tasksByDate = db.getTasksForRange(userId, from, to, &ok);
+        return ok ? std::optional<TasksByDate>(std::move(tasksByDate)) : std::nullopt;
+    }).then(this, [this, key, requestEpoch](const std::optional<TasksByDate>& loaded) {
+        if (requestEpoch == epoch) {
+            if (loaded) {
+                store(key.first, key.second, *loaded);
+            }
+            pending.remove(key);
+        }
+        return loaded.value_or(TasksByDate());
+    });
+    
+    pending.insert(key, future);
+    return future;
+}
+
+QFuture<bool> TaskRepository::createTask(const QString& title, const QDateTime& dateTime, bool isTimeBound,
+                                         const RecurrenceRule& recurrence)
+{
+    checkUser();
+    
+    int userId = cachedUserId;
+    return DatabaseWorker::instance().run([userId, title, dateTime, isTimeBound, recurrence](Database& db) {
+        return db.createTask(userId, title, dateTime, isTimeBound, recurrence);
+    });
+}
+
+QFuture<bool> TaskRepository::updateTask(int taskId, const QString& title, const QDateTime& dateTime,
+                                         bool isTimeBound, const RecurrenceRule& recurrence)
+{
+    checkUser();
+    
+    return DatabaseWorker::instance().run([taskId, title, dateTime, isTimeBound, recurrence](Database& db) {
+        return db.updateTask(taskId, title, dateTime, isTimeBound, recurrence);
+    });
+}
+
+QFuture<bool> TaskRepository::deleteTask(int taskId)
+{
+    checkUser();
+    
+    return DatabaseWorker::instance().run([taskId](Database& db) {
+        return db.deleteTask(taskId);
+    });
+}
+
+QFuture<bool> TaskRepository::moveTask(int taskId, const QString& title, const QDateTime& dateTime,
+                                       bool isTimeBound, const RecurrenceRule& recurrence)
+{
+    checkUser();
+    
+    int userId = cachedUserId;
+    return DatabaseWorker::instance().run([userId, taskId, title, dateTime, isTimeBound, recurrence](Database& db) {
+        if (!db.beginBatch()) {
+            return false;
+        }
+        
+        if (!db.createTask(userId, title, dateTime, isTimeBound, recurrence) || !db.deleteTask(taskId)) {
+            db.rollbackBatch();
+            return false;
+        }
+        
+        return db.commitBatch().committed;
+    });
+}
+
+void TaskRepository::cleanupOldData(const QDate& currentWeekStart)
+{
+    checkUser();
+    
+    // Очистка затрагивает только дни до порога, и забывать их нужно, лишь если что-то удалено.
+    // Загрузки, поставленные в очередь раньше очистки, завершатся до неё, поэтому дни забываются
+    // после её окончания, а не через сброс загрузок в полёте.
+    QDate threshold = currentWeekStart.addDays(-Database::RetentionDays);
+    
+    int userId = cachedUserId;
+    DatabaseWorker::instance().run([userId, currentWeekStart](Database& db) {
+        return db.cleanupOldData(userId, currentWeekStart);
+    }).then(this, [this, threshold](int removed) {
+        if (removed > 0) {
+            invalidateBefore(threshold);
+        }
+    });
+}
+
+void TaskRepository::clear()
+{
+    days.clear();
+    pending.clear();
+    ++epoch;
+}
+
+void TaskRepository::checkUser()
+{
+    int userId = Database::instance().getCurrentUserId();
+    if (userId != cachedUserId) {
+        clear();
+        cachedUserId = userId;
+    }
+}
+
+// В отличие от lookup не поднимает дни в очереди вытеснения: упреждающая загрузка
+// не должна продлевать жизнь дням, которые никто не смотрит.
+bool TaskRepository::isCached(const QDate& from, const QDate& to) const
+{
+    for (QDate date = from; date <= to; date = date.addDays(1)) {
+        if (!days.contains(date)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TaskRepository::lookup(const QDate& from, const QDate& to, TasksByDate& tasksByDate)
+{
+    for (QDate date = from; date <= to; date = date.addDays(1)) {
+        std::vector<TaskRecord> *tasks = days.object(date);
+        if (!tasks) {
+            tasksByDate.clear();
+            return false;
+        }
+        if (!tasks->empty()) {
+            tasksByDate.insert(date, *tasks);
+        }
+    }
+    return true;
+}
+
+void TaskRepository::store(const QDate& from, const QDate& to, const TasksByDate& tasksByDate)
+{
+    for (QDate date = from; date <= to; date = date.addDays(1)) {
+        std::vector<TaskRecord> tasks = tasksByDate.value(date);
+        qsizetype cost = qsizetype(tasks.size()) + 1;
+        days.insert(date, new std::vector<TaskRecord>(std::move(tasks)), cost);
+    }
+}
+
+void TaskRepository::onTasksChanged(int userId, const QDate& date)
+{
+    checkUser();
+    if (userId != cachedUserId) {
+        return;
+    }
+    
+    invalidate(date, false);
+    emit tasksChanged(date);
+}
+
+void TaskRepository::onTaskSeriesChanged(int userId, const QDate& from)
+{
+    checkUser();
+    if (userId != cachedUserId) {
+        return;
+    }
+    
+    invalidate(from, true);
+    emit taskSeriesChanged(from);
+}
+
+void TaskRepository::invalidate(const QDate& date, bool recurring)
+{
+    // Ответы, прочитанные до записи, могли застать старое состояние.
+    pending.clear();
+    ++epoch;
+    
+    if (!recurring) {
+        days.remove(date);
+        return;
+    }
+    
+    for (const QDate& cached : days.keys()) {
+        if (cached >= date) {
+            days.remove(cached);
+        }
+    }
+}
+
+void TaskRepository::invalidateBefore(const QDate& date)
+{
+    for (const QDate& cached : days.keys()) {
+        if (cached < date) {
+            days.remove(cached);
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef TASKREPOSITORY_H
+#define TASKREPOSITORY_H
+
+#include <QObject>
+#include <QCache>
+#include <QDate>
+#include <QDateTime>
+#include <QFuture>
+#include <QHash>
+#include <QPair>
+#include <vector>
+#include "records.h"
+
+// Кэш задач текущего пользователя по дням между представлениями и Database.
+// Чтение периода, целиком лежащего в кэше, не обращается к базе; промах загружает весь период
+// в потоке DatabaseWorker. Об изменениях кэш узнаёт из DatabaseNotifier и сбрасывает только
+// затронутые дни (для повторяющихся задач — все дни начиная с первого дня серии), после чего
+// передаёт сигнал дальше: представления подписываются на репозиторий, а не на базу, чтобы
+// перечитывать дни уже после сброса кэша.
+class TaskRepository : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Объём кэша в задачах; пустой день стоит одну единицу.
+    static constexpr int MaxCachedTasks = 5000;
+
+    static TaskRepository& instance();
+
+    QFuture<QHash<QDate, std::vector<TaskRecord>>> tasksForRange(const QDate& from, const QDate& to);
+
+    QFuture<std::vector<TaskRecord>> tasksForDay(const QDate& date);
+
+    // Загружает период в кэш заранее, если его там ещё нет. Счётчики попаданий не меняются.
+    void prefetch(const QDate& from, const QDate& to);
+
+    // Запись идёт в потоке DatabaseWorker; результат приходит через QFuture, а кэш сбрасывается
+    // по уведомлению базы, как и при любой другой записи.
+    QFuture<bool> createTask(const QString& title, const QDateTime& dateTime, bool isTimeBound,
+                             const RecurrenceRule& recurrence);
+
+    QFuture<bool> updateTask(int taskId, const QString& title, const QDateTime& dateTime,
+                             bool isTimeBound, const RecurrenceRule& recurrence);
+
+    QFuture<bool> deleteTask(int taskId);
+
+    // Новая задача и удаление старой идут одним пакетом: задача не пропадает и не двоится.
+    QFuture<bool> moveTask(int taskId, const QString& title, const QDateTime& dateTime,
+                           bool isTimeBound, const RecurrenceRule& recurrence);
+
+    void cleanupOldData(const QDate& currentWeekStart);
+
+    void clear();
+
+    quint64 cacheHits() const { return hits; }
+
+    quint64 cacheMisses() const { return misses; }
+
+signals:
+    void tasksChanged(const QDate& date);
+
+    void taskSeriesChanged(const QDate& from);
+
+private:
+    using TasksByDate = QHash<QDate, std::vector<TaskRecord>>;
+
+    TaskRepository();
+    TaskRepository(const TaskRepository&) = delete;
+    TaskRepository& operator=(const TaskRepository&) = delete;
+
+    void checkUser();
+    QFuture<TasksByDate> load(const QDate& from, const QDate& to);
+    bool isCached(const QDate& from, const QDate& to) const;
+    bool lookup(const QDate& from, const QDate& to, TasksByDate& tasksByDate);
+    void store(const QDate& from, const QDate& to, const TasksByDate& tasksByDate);
+    void onTasksChanged(int userId, const QDate& date);
+    void onTaskSeriesChanged(int userId, const QDate& from);
+    void invalidate(const QDate& date, bool recurring);
+    void invalidateBefore(const QDate& date);
+
+    QCache<QDate, std::vector<TaskRecord>> days;
+    // Загрузки в полёте: одинаковые запросы до ответа базы получают общий QFuture.
+    QHash<QPair<QDate, QDate>, QFuture<TasksByDate>> pending;
+    int cachedUserId;
+    // Увеличивается при каждой записи, чтобы ответ, прочитанный до неё, не попал в кэш.
+    quint64 epoch;
+    quint64 hits;
+    quint64 misses;
+};
+
+#endif
@@ -0,0 +1,214 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QStandardPaths>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QThread>
+#include "database.h"
+
+// Планы выборок, которые выполняются на каждой перерисовке: период задач, напоминания и отметки
+// привычек должны читаться диапазоном по индексу, а не перебором строк. Кроме того, соединения
+// разных потоков должны видеть записи друг друга.
+class DatabaseTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void taskRangeUsesCoveringIndex();
+    void pendingRemindersUseCoveringIndex();
+    void habitCompletionRangeUsesIndex_data();
+    void habitCompletionRangeUsesIndex();
+    void readsSeeWritesFromOtherConnections();
+    void recurringTaskRemindsOnEveryOccurrence();
+    void reinitializeReopensPooledConnections();
+
+private:
+    QString queryPlan(Database::StatementId id);
+
+    QTemporaryDir dir;
+};
+
+void DatabaseTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QVERIFY(dir.isValid());
+    QVERIFY(Database::instance().initialize(dir.filePath("tasks.db")));
+}
+
+QString DatabaseTest::queryPlan(Database::StatementId id)
+{
+    QString sql = Database::statementSql(id);
+    QSqlQuery query(Database::instance().connection());
+    if (!query.prepare("EXPLAIN QUERY PLAN " + sql)) {
+        return query.lastError().text();
+    }
+    
+    for (int i = 0; i < sql.count('?'); ++i) {
+        query.addBindValue(0);
+    }
+    if (!query.exec()) {
+        return query.lastError().text();
+    }
+    
+    QStringList details;
+    while (query.next()) {
+        details << query.value(3).toString();
+    }
+    return details.join('\n');
+}
+
+void DatabaseTest::taskRangeUsesCoveringIndex()
+{
+    QString plan = queryPlan(Database::StatementId::TasksForRange);
+    QVERIFY2(plan.contains("USING COVERING INDEX idx_tasks_user_day (user_id=? AND task_day>? AND task_day<?)"),
+             qPrintable(plan));
+}
+
+void DatabaseTest::pendingRemindersUseCoveringIndex()
+{
+    QString plan = queryPlan(Database::StatementId::PendingReminders);
+    QVERIFY2(plan.contains("USING COVERING INDEX idx_tasks_user_day (user_id=? AND task_day>? AND task_day<?)"),
+             qPrintable(plan));
+    QVERIFY2(plan.contains("reminder_deliveries USING PRIMARY KEY"), qPrintable(plan));
+}
+
+void DatabaseTest::habitCompletionRangeUsesIndex_data()
+{
+    QTest::addColumn<int>("statement");
+    
+    QTest::newRow("completions") << int(Database::StatementId::HabitCompletionsInRange);
+    QTest::newRow("count") << int(Database::StatementId::HabitCompletionCount);
+}
+
+void DatabaseTest::habitCompletionRangeUsesIndex()
+{
+    QFETCH(int, statement);
+    
+    QString plan = queryPlan(Database::StatementId(statement));
+    QVERIFY2(plan.contains("USING COVERING INDEX sqlite_autoindex_habit_completions_1 "
+                           "(habit_id=? AND completion_date>? AND completion_date<?)"),
+             qPrintable(plan));
+}
+
+// Однострочные выборки не должны оставлять оператор активным: иначе соединение потока
+// застревает на старом снимке и не видит записей, сделанных через другие соединения.
+void DatabaseTest::readsSeeWritesFromOtherConnections()
+{
+    Database& db = Database::instance();
+    QVERIFY(db.createUser("reader", "secret"));
+    QVERIFY(db.authenticateUser("reader", "secret"));
+    int userId = db.getCurrentUserId();
+    int habitId = db.createHabit(userId, "Привычка");
+    int noteId = db.createNote(userId, "Заметка");
+    QVERIFY(habitId > 0);
+    QVERIFY(noteId > 0);
+    
+    QThread thread;
+    QObject context;
+    context.moveToThread(&thread);
+    thread.start();
+    auto onThread = [&context](const std::function<void()>& fn) {
+        QMetaObject::invokeMethod(&context, fn, Qt::BlockingQueuedConnection);
+    };
+    
+    QDate date(2026, 3, 2);
+    db.getHabitStreak(habitId);
+    db.getNote(noteId);
+    db.isHabitCompleted(habitId, date);
+    onThread([&]() {
+        db.getHabitStreak(habitId);
+        db.getNote(noteId);
+    });
+    
+    bool written = false;
+    onThread([&]() {
+        written = db.createTask(userId, "Задача", QDateTime(date, QTime(9, 0)), true);
+    });
+    QVERIFY(written);
+    QCOMPARE(int(db.getTasksForRange(userId, date, date).value(date).size()), 1);
+    
+    db.getHabitStreak(habitId);
+    QVERIFY(db.createTask(userId, "Ещё задача", QDateTime(date, QTime(10, 0)), true));
+    
+    int threadTasks = 0;
+    bool marked = false;
+    onThread([&]() {
+        threadTasks = int(db.getTasksForRange(userId, date, date).value(date).size());
+        marked = db.markHabitCompleted(habitId, date);
+        db.releaseThreadConnection();
+    });
+    thread.quit();
+    QVERIFY(thread.wait(5000));
+    
+    QCOMPARE(threadTasks, 2);
+    QVERIFY(marked);
+    QVERIFY(db.isHabitCompleted(habitId, date));
+}
+
+void DatabaseTest::recurringTaskRemindsOnEveryOccurrence()
+{
+    Database& db = Database::instance();
+    QVERIFY(db.createUser("reminders", "secret"));
+    QVERIFY(db.authenticateUser("reminders", "secret"));
+    int userId = db.getCurrentUserId();
+    
+    QDate start(2026, 4, 1);
+    RecurrenceRule daily(RecurrenceRule::Frequency::Daily, 1);
+    QVERIFY(db.createTask(userId, "Зарядка", QDateTime(start, QTime(9, 0)), true, daily));
+    
+    QDate day = start.addDays(2);
+    QDateTime from(day, QTime(0, 0));
+    QDateTime to(day.addDays(1), QTime(0, 0));
+    std::vector<TaskRecord> pending = db.getPendingReminders(userId, from, to);
+    QCOMPARE(int(pending.size()), 1);
+    QCOMPARE(pending.front().date, day);
+    QCOMPARE(pending.front().time, QTime(9, 0));
+    
+    QVERIFY(db.recordReminderDelivery(pending.front().id, QDateTime(day, QTime(9, 0))));
+    QVERIFY(db.getPendingReminders(userId, from, to).empty());
+    
+    // Доставка одного повторения не гасит остальные.
+    QDate next = day.addDays(1);
+    QCOMPARE(int(db.getPendingReminders(userId, QDateTime(next, QTime(0, 0)),
+                                        QDateTime(next.addDays(1), QTime(0, 0))).size()), 1);
+}
+
+// Соединение потока, открытое до повторного initialize(), не должно остаться на прежнем файле.
+void DatabaseTest::reinitializeReopensPooledConnections()
+{
+    Database& db = Database::instance();
+    
+    QThread thread;
+    QObject context;
+    context.moveToThread(&thread);
+    thread.start();
+    auto onThread = [&context](const std::function<void()>& fn) {
+        QMetaObject::invokeMethod(&context, fn, Qt::BlockingQueuedConnection);
+    };
+    
+    bool before = false;
+    onThread([&]() {
+        before = db.authenticateUser("reader", "secret");
+    });
+    QVERIFY(before);
+    
+    QVERIFY(db.initialize(dir.filePath("other.db")));
+    QVERIFY(db.createUser("other", "secret"));
+    
+    bool oldUser = true;
+    bool newUser = false;
+    onThread([&]() {
+        oldUser = db.authenticateUser("reader", "secret");
+        newUser = db.authenticateUser("other", "secret");
+        db.releaseThreadConnection();
+    });
+    thread.quit();
+    QVERIFY(thread.wait(5000));
+    
+    QVERIFY(!oldUser);
+    QVERIFY(newUser);
+}
+
+QTEST_GUILESS_MAIN(DatabaseTest)
+#include "databasetest.moc"
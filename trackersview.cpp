@@ -1,14 +1,14 @@
 #include "trackersview.h"
 #include "database.h"
+#include "databaseworker.h"
+#include "databasenotifier.h"
 #include <QMessageBox>
 #include <QInputDialog>
 #include <QListWidget>
-#include <QFrame>
 #include <QSettings>
-#include <QSet>
 
 TrackersView::TrackersView(QWidget *parent)
-    : QWidget(parent)
+    : QWidget(parent), loadGeneration(0)
 {
 
     QVBoxLayout *layout = new QVBoxLayout(this);
@@ -32,155 +32,74 @@ TrackersView::TrackersView(QWidget *parent)
     
     layout->addLayout(buttonLayout);
     
-    scrollArea = new QScrollArea;
-    scrollArea->setWidgetResizable(true);
-    scrollArea->setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
-    scrollArea->setHorizontalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+    statusLabel = new QLabel;
+    statusLabel->setAlignment(Qt::AlignCenter);
+    statusLabel->setStyleSheet("font-size: 14px; color: #666;");
+    layout->addWidget(statusLabel);
     
-    contentWidget = new QWidget;
-    contentLayout = new QVBoxLayout(contentWidget);
-    contentLayout->setAlignment(Qt::AlignTop);
-    contentLayout->setSpacing(5);
-    contentLayout->setContentsMargins(10, 10, 10, 10);
-    
-    scrollArea->setWidget(contentWidget);
-    layout->addWidget(scrollArea);
+    // Сетка сама прокручивает строки и материализует только видимые.
+    habitModel = new HabitModel(this);
+    habitGrid = new HabitGrid;
+    habitGrid->setModel(habitModel);
+    habitGrid->hide();
+    layout->addWidget(habitGrid, 1);
+    layout->addStretch();
     
     connect(backButton, &QPushButton::clicked, this, &TrackersView::backRequested);
     connect(addButton, &QPushButton::clicked, this, &TrackersView::onAddHabitClicked);
     connect(deleteButton, &QPushButton::clicked, this, &TrackersView::onDeleteHabitClicked);
+    connect(habitGrid, &HabitGrid::dayToggled, this, &TrackersView::onDayCellClicked);
+    connect(&DatabaseNotifier::instance(), &DatabaseNotifier::habitCompletionChanged,
+            this, &TrackersView::onHabitCompletionChanged);
 }
 
 void TrackersView::refreshTrackers()
 {
-
-    QLayoutItem* item;
-    while ((item = contentLayout->takeAt(0)) != nullptr) {
-        delete item->widget();
-        delete item;
-    }
-    habitRows.clear();
+    int generation = ++loadGeneration;
     
     Database& db = Database::instance();
     if (!db.isLoggedIn()) {
-        QLabel *noAuthLabel = new QLabel("Необходимо войти в систему");
-        noAuthLabel->setAlignment(Qt::AlignCenter);
-        contentLayout->addWidget(noAuthLabel);
+        showStatus("Необходимо войти в систему");
         return;
     }
     
-    int userId = db.getCurrentUserId();
-    auto habits = db.getHabits(userId);
+    showStatus("Загрузка...");
     
-    if (habits.isEmpty()) {
-        QLabel *noHabitsLabel = new QLabel("Привычек пока нет");
-        noHabitsLabel->setAlignment(Qt::AlignCenter);
-        noHabitsLabel->setStyleSheet("font-size: 14px; color: #666;");
-        contentLayout->addWidget(noHabitsLabel);
-        return;
-    }
-    
-    for (const auto& habit : habits) {
-        int habitId = habit["id"].toInt();
-        QString habitName = habit["name"].toString();
-        createHabitRow(habitId, habitName);
-    }
-    
-    contentLayout->addStretch();
+    // Грузится только список привычек: отметки и серии модель дочитывает для видимых строк.
+    int userId = db.getCurrentUserId();
+    DatabaseWorker::instance().run([userId](Database& db) {
+        return db.getHabits(userId);
+    }).then(this, [this, generation](const std::vector<HabitRecord>& habits) {
+        if (generation != loadGeneration) {
+            return;
+        }
+        
+        showHabits(habits);
+    });
 }
 
-void TrackersView::createHabitRow(int habitId, const QString& habitName)
+void TrackersView::showStatus(const QString& text)
 {
-    HabitRow hr;
-    hr.habitId = habitId;
-    
-    QFrame *rowFrame = new QFrame;
-    rowFrame->setFrameStyle(QFrame::Box);
-    rowFrame->setStyleSheet("QFrame { background-color: #f9f9f9; border: 1px solid #ddd; border-radius: 3px; padding: 5px; }");
-    hr.rowFrame = rowFrame;
-    
-    QHBoxLayout *rowLayout = new QHBoxLayout(rowFrame);
-    rowLayout->setSpacing(5);
-    rowLayout->setContentsMargins(5, 5, 5, 5);
-    hr.rowLayout = rowLayout;
-    
-    QLabel *nameLabel = new QLabel(habitName);
-    nameLabel->setStyleSheet("font-size: 14px; font-weight: bold; color: #333; min-width: 150px;");
-    nameLabel->setAlignment(Qt::AlignLeft | Qt::AlignVCenter);
-    rowLayout->addWidget(nameLabel);
-    hr.nameLabel = nameLabel;
-    
-    QDate today = QDate::currentDate();
-    int year = today.year();
-    int month = today.month();
-    QDate firstDay = QDate(year, month, 1);
-    int daysInMonth = firstDay.daysInMonth();
-    
-    QList<QDate> completedDates = Database::instance().getHabitCompletionsForMonth(habitId, year, month);
-    QSet<QDate> completedSet(completedDates.begin(), completedDates.end());
-    
-    for (int day = 1; day <= daysInMonth; ++day) {
-        QDate date(year, month, day);
-        bool isCompleted = completedSet.contains(date);
-        bool isFuture = date > today;
-        
-        QPushButton *dayButton = new QPushButton(QString::number(day));
-        dayButton->setMinimumSize(25, 25);
-        dayButton->setMaximumSize(25, 25);
-        
-        if (isFuture) {
-
-            dayButton->setEnabled(false);
-            dayButton->setStyleSheet("QPushButton { background-color: #f0f0f0; color: #999; font-size: 10px; border: 1px solid #ccc; }");
-        } else if (isCompleted) {
-
-            dayButton->setStyleSheet("QPushButton { background-color: #90EE90; color: #000; font-size: 10px; border: 1px solid #ccc; font-weight: bold; }");
-        } else {
-
-            dayButton->setStyleSheet("QPushButton { background-color: white; color: #000; font-size: 10px; border: 1px solid #ccc; }");
-        }
-        
-        dayButton->setProperty("habitId", habitId);
-        dayButton->setProperty("date", date);
-        
-        if (!isFuture) {
-            connect(dayButton, &QPushButton::clicked, [this, habitId, date]() {
-                onDayCellClicked(habitId, date);
-            });
-        }
-        
-        rowLayout->addWidget(dayButton);
-        hr.dayButtons.append(dayButton);
-    }
-    
-    int streak = calculateStreak(habitId);
-    
-    QLabel *streakLabel = new QLabel(QString::number(streak));
-    streakLabel->setStyleSheet("font-size: 14px; font-weight: bold; color: #333; min-width: 50px;");
-    streakLabel->setAlignment(Qt::AlignCenter);
-    rowLayout->addWidget(streakLabel);
-    hr.streakLabel = streakLabel;
-    
-    contentLayout->addWidget(rowFrame);
-    habitRows.append(hr);
+    habitGrid->hide();
+    habitModel->clear();
+    statusLabel->setText(text);
+    statusLabel->show();
 }
 
-int TrackersView::calculateStreak(int habitId) const
+void TrackersView::showHabits(const std::vector<HabitRecord>& habits)
 {
-    Database& db = Database::instance();
-    QDate today = QDate::currentDate();
-    int streak = 0;
-    
-    for (int i = 0; i < 365; ++i) {
-        QDate checkDate = today.addDays(-i);
-        if (db.isHabitCompleted(habitId, checkDate)) {
-            streak++;
-        } else {
-            break;
-        }
+    if (habits.empty()) {
+        showStatus("Привычек пока нет");
+        return;
     }
     
-    return streak;
+    QDate today = QDate::currentDate();
+    QDate firstDay(today.year(), today.month(), 1);
+    
+    statusLabel->hide();
+    habitGrid->setMonth(firstDay, today);
+    habitModel->setHabits(habits, firstDay);
+    habitGrid->show();
 }
 
 void TrackersView::onAddHabitClicked()
@@ -201,34 +120,32 @@ void TrackersView::onAddHabitClicked()
     }
     
     int userId = db.getCurrentUserId();
-    int habitId = db.createHabit(userId, name);
-    
-    if (habitId > 0) {
-        refreshTrackers();
-    } else {
-        QMessageBox::warning(this, "Ошибка", "Не удалось создать привычку");
-    }
+    DatabaseWorker::instance().run([userId, name](Database& db) {
+        return db.createHabit(userId, name);
+    }).then(this, [this](int habitId) {
+        if (habitId > 0) {
+            refreshTrackers();
+        } else {
+            QMessageBox::warning(this, "Ошибка", "Не удалось создать привычку");
+        }
+    });
 }
 
+// Список привычек уже загружен в модель целиком, поэтому выбор не обращается к базе.
 void TrackersView::onDeleteHabitClicked()
 {
-
-    Database& db = Database::instance();
-    if (!db.isLoggedIn()) {
+    if (!Database::instance().isLoggedIn()) {
         return;
     }
     
-    int userId = db.getCurrentUserId();
-    auto habits = db.getHabits(userId);
-    
-    if (habits.isEmpty()) {
+    if (habitModel->rowCount() == 0) {
         QMessageBox::information(this, "Информация", "Нет привычек для удаления");
         return;
     }
     
     QStringList habitNames;
-    for (const auto& habit : habits) {
-        habitNames << habit["name"].toString();
+    for (int row = 0; row < habitModel->rowCount(); ++row) {
+        habitNames << habitModel->name(row);
     }
     
     bool ok;
@@ -241,9 +158,9 @@ void TrackersView::onDeleteHabitClicked()
     }
     
     int habitId = -1;
-    for (const auto& habit : habits) {
-        if (habit["name"].toString() == selectedName) {
-            habitId = habit["id"].toInt();
+    for (int row = 0; row < habitModel->rowCount(); ++row) {
+        if (habitModel->name(row) == selectedName) {
+            habitId = habitModel->habitId(row);
             break;
         }
     }
@@ -259,29 +176,97 @@ void TrackersView::onDeleteHabitClicked()
         return;
     }
     
-    if (db.deleteHabit(habitId)) {
-        refreshTrackers();
-        QMessageBox::information(this, "Успех", "Привычка удалена");
-    } else {
-        QMessageBox::warning(this, "Ошибка", "Не удалось удалить привычку");
-    }
+    DatabaseWorker::instance().run([habitId](Database& db) {
+        return db.deleteHabit(habitId);
+    }).then(this, [this](bool deleted) {
+        if (deleted) {
+            refreshTrackers();
+            QMessageBox::information(this, "Успех", "Привычка удалена");
+        } else {
+            QMessageBox::warning(this, "Ошибка", "Не удалось удалить привычку");
+        }
+    });
 }
 
+// Ячейка и серия меняются сразу в памяти, запись уходит в поток базы. Если записать не удалось,
+// отметка и серия возвращаются к прежним.
 void TrackersView::onDayCellClicked(int habitId, const QDate& date)
 {
-    Database& db = Database::instance();
+    int row = habitModel->rowOf(habitId);
+    if (row < 0 || !habitModel->isLoaded(row)) {
+        return;
+    }
     
-    bool isCompleted = db.isHabitCompleted(habitId, date);
+    bool completed = !habitGrid->isCompleted(habitId, date);
+    HabitStreak previous = habitModel->streak(row);
     
-    if (isCompleted) {
-
-        if (db.unmarkHabitCompleted(habitId, date)) {
-            refreshTrackers();
+    habitGrid->setCompleted(habitId, date, completed);
+    
+    HabitStreak streak = previous;
+    if (completed ? streak.applyMark(date) : streak.applyUnmark(date)) {
+        applyStreak(habitId, streak);
+    }
+    // Иначе серию без полного пересчёта не получить: точное значение придёт после записи.
+    
+    QPair<int, QDate> key(habitId, date);
+    ++pendingToggles[key];
+    
+    int generation = loadGeneration;
+    DatabaseWorker::instance().run([habitId, date, completed](Database& db) {
+        return completed ? db.markHabitCompleted(habitId, date) : db.unmarkHabitCompleted(habitId, date);
+    }).then(this, [this, generation, key, completed, previous](bool saved) {
+        if (--pendingToggles[key] == 0) {
+            pendingToggles.remove(key);
         }
-    } else {
-
-        if (db.markHabitCompleted(habitId, date)) {
-            refreshTrackers();
+        if (saved || generation != loadGeneration) {
+            return;
+        }
+        
+        // Более позднее переключение той же ячейки ещё в полёте: откатывать его рано.
+        if (!pendingToggles.contains(key)) {
+            habitGrid->setCompleted(key.first, key.second, !completed);
+            applyStreak(key.first, previous);
         }
+        reloadStreak(key.first);
+        QMessageBox::warning(this, "Ошибка", "Не удалось сохранить отметку привычки");
+    });
+}
+
+// Приходит и после собственной записи: ячейка уже перерисована, а серия сверяется с базой.
+// Незагруженные строки пропускаются моделью: их отметки ещё будут прочитаны целиком.
+void TrackersView::onHabitCompletionChanged(int habitId, const QDate& date, bool completed)
+{
+    if (!habitGrid->hasHabit(habitId)) {
+        return;
     }
+    
+    if (!pendingToggles.contains(qMakePair(habitId, date))) {
+        habitGrid->setCompleted(habitId, date, completed);
+    }
+    reloadStreak(habitId);
+}
+
+void TrackersView::applyStreak(int habitId, const HabitStreak& streak)
+{
+    habitModel->setStreak(habitModel->rowOf(habitId), streak);
+}
+
+// Для строки, отметки которой ещё не загружены, серия придёт вместе с ними.
+void TrackersView::reloadStreak(int habitId)
+{
+    int row = habitModel->rowOf(habitId);
+    if (row < 0 || !habitModel->isLoaded(row)) {
+        return;
+    }
+    
+    int generation = loadGeneration;
+    DatabaseWorker::instance().run([habitId](Database& db) {
+        return db.getHabitStreak(habitId);
+    }).then(this, [this, generation, habitId](const HabitStreak& streak) {
+        if (generation != loadGeneration) {
+            return;
+        }
+        
+        applyStreak(habitId, streak);
+    });
 }
@@ -4,11 +4,15 @@
 #include <QWidget>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
-#include <QScrollArea>
 #include <QPushButton>
 #include <QLabel>
-#include <QGridLayout>
 #include <QDate>
+#include <QHash>
+#include <QPair>
+#include <vector>
+#include "records.h"
+#include "habitgrid.h"
+#include "habitmodel.h"
 
 class TrackersView : public QWidget
 {
@@ -33,30 +37,31 @@ public slots:
 private slots:
     
     void onDayCellClicked(int habitId, const QDate& date);
+    
+    void onHabitCompletionChanged(int habitId, const QDate& date, bool completed);
 
 private:
     
-    void createHabitRow(int habitId, const QString& habitName);
+    void showStatus(const QString& text);
+    
+    void showHabits(const std::vector<HabitRecord>& habits);
+    
+    void applyStreak(int habitId, const HabitStreak& streak);
+    
+    void reloadStreak(int habitId);
     
-    int calculateStreak(int habitId) const;
+    int loadGeneration;
     
-    QScrollArea *scrollArea;
-    QWidget *contentWidget;
-    QVBoxLayout *contentLayout;
+    
+    // Записи отметок в полёте: пока они не завершились, ячейке верит представление, а не эхо из базы.
+    QHash<QPair<int, QDate>, int> pendingToggles;
+    
+    QLabel *statusLabel;
+    HabitModel *habitModel;
+    HabitGrid *habitGrid;
     QPushButton *backButton;
     QPushButton *addButton;
     QPushButton *deleteButton;
-    
-    struct HabitRow {
-        QFrame *rowFrame;
-        QHBoxLayout *rowLayout;
-        QLabel *nameLabel;
-        QVector<QPushButton*> dayButtons;
-        QLabel *streakLabel;
-        int habitId;
-    };
-    
-    QVector<HabitRow> habitRows;
 };
 
 #endif
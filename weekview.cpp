@@ -1,5 +1,6 @@
 #include "weekview.h"
 #include "database.h"
+#include "taskrepository.h"
 #include <QLocale>
 #include <QScrollArea>
 #include <QFrame>
@@ -23,8 +24,8 @@ static QString getMonthNameNominative(int month)
     return QString();
 }
 
-WeekView::WeekView(QWidget *parent)
-    : QWidget(parent)
+WeekView::WeekView(TaskModel *model, QWidget *parent)
+    : QWidget(parent), taskModel(model)
 {
 
     QVBoxLayout *mainLayout = new QVBoxLayout(this);
@@ -33,8 +34,12 @@ WeekView::WeekView(QWidget *parent)
     weekLabel = new QLabel;
     weekLabel->setStyleSheet("font-size: 16px; font-weight: bold;");
     weekLabel->setAlignment(Qt::AlignCenter);
+    loadingLabel = new QLabel("Загрузка...");
+    loadingLabel->setStyleSheet("font-size: 10px; color: #888;");
+    loadingLabel->hide();
     labelLayout->addStretch();
     labelLayout->addWidget(weekLabel);
+    labelLayout->addWidget(loadingLabel);
     labelLayout->addStretch();
     mainLayout->addLayout(labelLayout);
     
@@ -63,6 +68,10 @@ WeekView::WeekView(QWidget *parent)
     nextButton->setMaximumWidth(50);
     gridContainerLayout->addWidget(nextButton);
     
+    // Удержание стрелки листает недели подряд; соседние периоды к этому моменту уже в кэше.
+    prevButton->setAutoRepeat(true);
+    nextButton->setAutoRepeat(true);
+    
     dayWidgets.resize(7);
     
     QLocale locale(QLocale::Russian);
@@ -99,6 +108,7 @@ WeekView::WeekView(QWidget *parent)
         dw.header = new QLabel;
         dw.header->setStyleSheet("font-weight: bold; font-size: 14px;");
         dw.header->setCursor(Qt::PointingHandCursor);
+        dw.header->setTextInteractionFlags(Qt::TextBrowserInteraction);
         headerLayout->addWidget(dw.header);
         headerLayout->addStretch();
         
@@ -140,6 +150,9 @@ WeekView::WeekView(QWidget *parent)
     connect(prevButton, &QPushButton::clicked, this, &WeekView::onPrevWeekClicked);
     connect(nextButton, &QPushButton::clicked, this, &WeekView::onNextWeekClicked);
     
+    connect(taskModel, &QAbstractItemModel::modelReset, this, &WeekView::onModelReset);
+    connect(taskModel, &TaskModel::dayChanged, this, &WeekView::onDayChanged);
+    
     setWeekStart(QDate::currentDate());
 }
 
@@ -205,15 +218,6 @@ void WeekView::refreshWeek()
     QSettings settings;
     int firstDayOfWeek = settings.value("firstDayOfWeek", 1).toInt();
     
-    QVector<int> dayOrder(7);
-    for (int i = 0; i < 7; ++i) {
-        dayOrder[i] = i;
-    }
-    
-    for (int i = 0; i < 7; ++i) {
-        gridLayout->removeWidget(dayWidgets[i].frame);
-    }
-    
     QStringList dayNames;
     if (firstDayOfWeek == 7) {
 
@@ -235,17 +239,49 @@ void WeekView::refreshWeek()
         }
     }
     
+    // Ячейки дней остаются на своих местах в сетке; меняются только даты и тексты.
     for (int col = 0; col < 7; ++col) {
-        int dayIndex = dayOrder[col];
-        QDate dayDate = weekStartDate.addDays(col);
-        
-        setupDayWidget(dayIndex, dayDate);
-        
-        refreshDayWidget(dayIndex);
-        
-        dayWidgets[dayIndex].header->setProperty("dayIndex", dayIndex);
-        
-        gridLayout->addWidget(dayWidgets[dayIndex].frame, 1, col);
+        setupDayWidget(col, weekStartDate.addDays(col));
+    }
+    
+    loadTasks(weekStartDate, weekEnd);
+}
+
+void WeekView::loadTasks(const QDate& from, const QDate& to)
+{
+    loadingLabel->setVisible(Database::instance().isLoggedIn());
+    taskModel->setRange(from, to);
+    
+    if (!Database::instance().isLoggedIn()) {
+        return;
+    }
+    
+    // Соседние недели загружаются заранее, чтобы переход по стрелкам не ждал базу.
+    TaskRepository& repository = TaskRepository::instance();
+    if (canGoBack()) {
+        repository.prefetch(from.addDays(-7), to.addDays(-7));
+    }
+    repository.prefetch(from.addDays(7), to.addDays(7));
+}
+
+void WeekView::onModelReset()
+{
+    if (!taskModel->hasRange(weekStart, weekStart.addDays(6))) {
+        return;
+    }
+    
+    for (int i = 0; i < dayWidgets.size(); ++i) {
+        refreshDayWidget(i);
+    }
+    loadingLabel->hide();
+}
+
+void WeekView::onDayChanged(const QDate& date)
+{
+    for (int i = 0; i < dayWidgets.size(); ++i) {
+        if (dayWidgets[i].date == date) {
+            refreshDayWidget(i);
+        }
     }
 }
 
@@ -254,7 +290,6 @@ void WeekView::setupDayWidget(int index, const QDate& date)
     DayWidget& dw = dayWidgets[index];
     dw.date = date;
     dw.header->setText(formatDateHeader(date));
-    dw.header->setTextInteractionFlags(Qt::TextBrowserInteraction);
 }
 
 QString WeekView::formatDateHeader(const QDate& date) const
@@ -274,47 +309,47 @@ void WeekView::refreshDayWidget(int index)
 {
     DayWidget& dw = dayWidgets[index];
     
-    QLayoutItem* item;
-    while ((item = dw.tasksLayout->takeAt(0)) != nullptr) {
-        delete item->widget();
-        delete item;
-    }
-    
-    Database& db = Database::instance();
-    if (!db.isLoggedIn()) {
-        dw.moreLabel->hide();
-        return;
-    }
-    
-    auto tasks = db.getTasksForDay(db.getCurrentUserId(), dw.date);
-    
     const int MAX_VISIBLE_TASKS = 8;
-    bool showMore = tasks.size() > MAX_VISIBLE_TASKS;
-    int tasksToShow = showMore ? MAX_VISIBLE_TASKS : tasks.size();
+    QModelIndex day = taskModel->dayIndex(dw.date);
+    int taskCount = (day.isValid() && Database::instance().isLoggedIn()) ? taskModel->rowCount(day) : 0;
+    bool showMore = taskCount > MAX_VISIBLE_TASKS;
+    int tasksToShow = showMore ? MAX_VISIBLE_TASKS : taskCount;
     
+    // Текст и видимость меняются, только если действительно изменились, чтобы не запускать
+    // лишний пересчёт раскладки.
     for (int i = 0; i < tasksToShow; ++i) {
-        const auto& task = tasks[i];
-        QString title = task["title"].toString();
-        bool isTimeBound = task["is_time_bound"].toBool();
-        QString timeStr;
-        
-        if (isTimeBound && !task["task_time"].isNull()) {
-            QTime time = task["task_time"].toTime();
-            timeStr = time.toString("HH:mm") + " ";
+        QLabel *label = taskLabel(dw, i);
+        QString displayText = taskModel->index(i, 0, day).data().toString();
+        if (label->text() != displayText) {
+            label->setText(displayText);
+        }
+        if (label->isHidden()) {
+            label->show();
         }
-        
-        QString displayText = timeStr + title;
-        QLabel *taskLabel = new QLabel(displayText);
-        taskLabel->setWordWrap(true);
-        taskLabel->setStyleSheet("padding: 2px;");
-        dw.tasksLayout->addWidget(taskLabel);
     }
     
-    if (showMore) {
-        dw.moreLabel->show();
-    } else {
-        dw.moreLabel->hide();
+    for (int i = tasksToShow; i < dw.taskLabels.size(); ++i) {
+        if (!dw.taskLabels[i]->isHidden()) {
+            dw.taskLabels[i]->hide();
+        }
+    }
+    
+    if (dw.moreLabel->isHidden() == showMore) {
+        dw.moreLabel->setVisible(showMore);
+    }
+}
+
+// Метка задачи с номером index из пула дня; пул растёт до наибольшего числа задач за день.
+QLabel* WeekView::taskLabel(DayWidget& dw, int index)
+{
+    while (dw.taskLabels.size() <= index) {
+        QLabel *label = new QLabel;
+        label->setWordWrap(true);
+        label->setStyleSheet("padding: 2px;");
+        dw.tasksLayout->addWidget(label);
+        dw.taskLabels.append(label);
     }
+    return dw.taskLabels[index];
 }
 
 void WeekView::onPrevWeekClicked()
@@ -323,12 +358,6 @@ void WeekView::onPrevWeekClicked()
     if (canGoBack()) {
 
         setWeekStart(weekStart.addDays(-7));
-        
-        Database& db = Database::instance();
-        if (db.isLoggedIn()) {
-            QDate currentMonday = getMonday(QDate::currentDate());
-            db.cleanupOldData(db.getCurrentUserId(), currentMonday);
-        }
     }
 }
 
@@ -336,12 +365,6 @@ void WeekView::onNextWeekClicked()
 {
 
     setWeekStart(weekStart.addDays(7));
-    
-    Database& db = Database::instance();
-    if (db.isLoggedIn()) {
-        QDate currentMonday = getMonday(QDate::currentDate());
-        db.cleanupOldData(db.getCurrentUserId(), currentMonday);
-    }
 }
 
 bool WeekView::eventFilter(QObject *obj, QEvent *event)
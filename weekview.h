@@ -9,13 +9,14 @@
 #include <QScrollArea>
 #include <QVBoxLayout>
 #include <QMouseEvent>
+#include "taskmodel.h"
 
 class WeekView : public QWidget
 {
     Q_OBJECT
 
 public:
-    explicit WeekView(QWidget *parent = nullptr);
+    explicit WeekView(TaskModel *model, QWidget *parent = nullptr);
     void refreshWeek();
     void setWeekStart(const QDate& date);
     QDate getWeekStart() const { return weekStart; }
@@ -27,8 +28,11 @@ signals:
 private slots:
     void onPrevWeekClicked();
     void onNextWeekClicked();
+    void onModelReset();
+    void onDayChanged(const QDate& date);
 
 private:
+    TaskModel *taskModel;
     QDate weekStart;
     QDate getMonday(const QDate& date) const;
     bool canGoBack() const;
@@ -36,6 +40,7 @@ private:
     QPushButton *prevButton;
     QPushButton *nextButton;
     QLabel *weekLabel;
+    QLabel *loadingLabel;
     QGridLayout *gridLayout;
     QWidget *contentWidget;
     
@@ -45,6 +50,8 @@ private:
         QPushButton *addButton;
         QVBoxLayout *tasksLayout;
         QLabel *moreLabel;
+        // Метки задач переиспользуются между обновлениями; лишние скрыты.
+        QVector<QLabel*> taskLabels;
         QDate date;
     };
     
@@ -53,6 +60,8 @@ private:
     void setupDayWidget(int index, const QDate& date);
     QString formatDateHeader(const QDate& date) const;
     void refreshDayWidget(int index);
+    QLabel* taskLabel(DayWidget& dw, int index);
+    void loadTasks(const QDate& from, const QDate& to);
     bool eventFilter(QObject *obj, QEvent *event) override;
 };
 